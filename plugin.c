@@ -1,25 +1,70 @@
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
 #include <unistd.h>
 #include <time.h>
 #include <math.h>
-
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifndef M_PI
 #define M_PI 3.141592653589793238462
-
+#endif
+
+#ifdef TARGET_LV2
+#include <lv2/core/lv2.h>
+#include <lv2/atom/atom.h>
+#include <lv2/urid/urid.h>
+#include <lv2/worker/worker.h>
+/* the few jack types used throughout, as an lv2 host hands them over */
+typedef float jack_default_audio_sample_t;
+typedef uint32_t jack_nframes_t;
+typedef uint8_t jack_midi_data_t;
+#else
 #include <jack/jack.h>
 #include <jack/midiport.h>
+#endif
 
-#define PATH_IMPULSE_RESPONSE /*"guitar2.pcm"*/ /*"harp.pcm"*/ "guitar2.pcm"
+#define PATHS_IMPULSE_RESPONSE "guitar2.pcm", "guitar.pcm", "harp.pcm", "bass.pcm", "ir.pcm", "ir2.pcm", "ir3.pcm", "ir4.pcm" /* picked by program change, the first to start with */
+#define IMPULSE_RESPONSE_RATE 48000 /* Hz, of the .pcm files */
+#define PATH_BANK "build/bodies.bank" /* made by make bank, its bodies are the programs instead when it is there */
+#define BANK_RATES 44100, 48000, 88200, 96000 /* Hz, kernels made ahead for these */
+#define PATH_PATCH "synth.patch" /* read at startup, see patch_t, the instrument defines below are only its defaults */
 
 #define N_VOICES 128
-#define VOICE_MIN 36-12
-#define VOICE_MAX 97-12
+#define VOICE_MIN (36-12)
+#define VOICE_MAX (97-12)
 #define SYMPATHETIC_RESONANCE /*5*/ /*5*/ 1
+#define COUPLING_ADMITTANCE_MIN 1 /* of the lowest string to the bridge, relative to the others */
+#define COUPLING_ADMITTANCE_MAX 1 /* of the highest */
+#define COUPLING_HARMONIC 0 /*0.5*/ /* share of the coupling going between strings with related partials */
 #define BEND_RANGE 2 /* semitones */
-#define N_DELAY_SAMPLES 8000
+#define SIZE_CACHE_LINE 64 /* bytes, every delay line starts on one */
+#define DELAY_INTERPOLATION_ORDER 3 /* lagrange, 0 rounds strings to whole samples */
+#define TIME_GLIDE 0.005 /* s, time constant of string length changes */
+#define N_FRAMES_BLOCK 256 /* largest chunk processed at once */
+#define OVERSAMPLE 1 /* 1, 2 or 4, times the rate the strings from OVERSAMPLE_VOICE_MIN up run at */
+#define OVERSAMPLE_VOICE_MIN 72 /* the lowest string oversampled, they get short up there */
+#define HALF_BAND_N_TAPS 16 /* on either side of the centre one, of the filters bringing them back down */
+#define MODAL_VOICE_MIN N_VOICES /* the lowest string run as a bank of modes rather than a waveguide, N_VOICES for none */
+#define MODAL_N_MODES 8 /* partials per string, those past nyquist are left out */
+#define MODAL_N_ITERATIONS 3 /* of newton, tuning a partial to the loop */
+#define MODAL_TOLERANCE 0.001 /* of the transitions and the relative length, moving further refits the modes */
+#define MODAL_N_FRAMES_FIT 16 /* samples run on one fit at most, so the transitions of a note on are followed */
+#define CONVOLVER_PARTITION_SIZE 64 /* power of 2 */
+#define CONVOLVER_N_PARTITIONS_ALL ((size_t) -1) /* no cut, impulse responses are only bounded by memory and the time to run them */
+#define CONVOLVER_N_FADE 2048 /* samples, crossfade from one impulse response to the next */
+#define CONVOLVER_N_PARTITIONS_GROW 4 /* per partition, as a cut impulse response grows back */
+#define RESAMPLE_N_ZEROS 16 /* zero crossings of the windowed sinc on either side */
 #define BRIDGE_COEFFICIENT_BYPASS_MIN 0.00/*0.00*/
 #define BRIDGE_COEFFICIENT_BYPASS_MAX 0.00/*0.00*/
 #define RESONANCE_BODY 1
@@ -36,10 +81,103 @@
 #define HAMMER_STRIKE_POSITION_CENTER 0.15 /*0.5*/ /*0.15*/
 #define HAMMER_STRIKE_POSITION_VARIATION 0.05 /* plus or minus */
 #define VOLUME /*2*/ /*1*/ 0.5
-
-static double noise () {
-
-    return rand () / (double) RAND_MAX;
+#define OUTPUT_PAN_SPREAD 0.5 /* 0 mono, 1 lowest string hard left and highest hard right */
+#define OUTPUT_N_STEMS 4 /* direct outs of the dry strings split evenly over the playable range, one per string at most */
+#define VOICE_FLOOR -120 /* dB, voices quieter than this for a whole period stop being processed */
+#define VOICE_THRESHOLD_SYMPATHETIC -70 /* dB, a string hearing sympathetic input louder than this wakes, well above VOICE_FLOOR so it lasts */
+#define VOICE_BANK true /* run the strings side by side in simd lanes */
+#define COMMUTED false /* plucks the strings through the body rather than running it after them, see excitations_t */
+#define N_WORKERS 0 /* threads sharing the strings, 0 runs them on the process thread */
+#define WORKER_N_VOICES_MIN 8 /* fewer strings than this per worker are not worth a thread */
+#define WORKER_PRIORITY 70 /* SCHED_FIFO */
+#define WORKER_N_SPINS_YIELD 4096
+#define N_CHANNELS 16 /* midi, one synth each at most */
+#define N_MESSAGES_LOG 1024 /* power of 2, midi messages waiting to be printed */
+#define N_MESSAGES_CONTROL 1024 /* power of 2, controls posted from other threads */
+#define LOGGER_INTERVAL 10 /* ms */
+#define LOADER_INTERVAL 10 /* ms */
+#define TELEMETRY true /* time every period on the process thread */
+#define TELEMETRY_INTERVAL 10 /* s of audio between load reports, 0 reports xruns only */
+#define N_PERIODS_TELEMETRY 256 /* power of 2, periods waiting for the reporter */
+#define GOVERNOR true /* steps down through the tiers rather than miss deadlines, see governor_t */
+#define GOVERNOR_LOAD_DOWN 0.75 /* of a period, one taking longer steps down a tier */
+#define GOVERNOR_LOAD_UP 0.4 /* of a period, staying under it for GOVERNOR_TIME_UP steps back up one */
+#define GOVERNOR_TIME_UP 2 /* s of audio */
+#define GOVERNOR_N_PARTITIONS 16 /* of CONVOLVER_PARTITION_SIZE, the body is cut to from TIER_BODY down */
+#define GOVERNOR_FLOOR -60 /* dB, VOICE_FLOOR from TIER_STEAL down */
+#define BANK_MAGIC "PLUKBANK"
+#define BANK_VERSION 1
+#define BANK_N_RATES_MAX 8
+#define BANK_SIZE_NAME 32
+#define BANK_ALIGNMENT 64 /* bytes, of every block in a bank */
+#define SIZE_PATH 4096 /* bytes, of the paths bodies and banks are opened by */
+
+#define PRECISION_DOUBLE 0
+#define PRECISION_FLOAT 1
+#define PRECISION_MIXED 2 /* float samples, double filter states */
+#ifndef PRECISION
+#define PRECISION PRECISION_DOUBLE
+#endif
+
+#if PRECISION == PRECISION_DOUBLE
+typedef double sample_t; /* buffers, delay lines, impulse responses */
+typedef double state_t; /* filter states and coefficients */
+#elif PRECISION == PRECISION_FLOAT
+typedef float sample_t;
+typedef float state_t;
+#else
+typedef float sample_t;
+typedef double state_t;
+#endif
+
+#if defined __AVX__
+#define SIZE_VECTOR 32
+#elif defined __SSE2__
+#define SIZE_VECTOR 16
+#else
+#define SIZE_VECTOR sizeof (state_t)
+#endif
+#define N_LANES (SIZE_VECTOR / sizeof (state_t))
+#define N_LANE_GROUPS ((N_VOICES + N_LANES - 1) / N_LANES)
+#define N_MODAL_GROUPS ((MODAL_N_MODES + N_LANES - 1) / N_LANES)
+#define N_PITCH_CLASSES 12
+#define N_COUPLING_CHANNELS (1 + N_PITCH_CLASSES) /* the bridge, then one per pitch class */
+
+/* what the strings are mixed into, each block */
+#define BUS_LEFT 0 /* the dry strings, panned */
+#define BUS_RIGHT 1
+#define BUS_STEM 2 /* the first of OUTPUT_N_STEMS */
+#define BUS_SEND (BUS_STEM + OUTPUT_N_STEMS) /* the first of N_COUPLING_CHANNELS, see coupling_t */
+#define N_BUSSES (BUS_SEND + N_COUPLING_CHANNELS)
+
+/* what the synth plays, one port each */
+#define OUTPUT_LEFT 0 /* through the body */
+#define OUTPUT_RIGHT 1
+#define OUTPUT_DRY_LEFT 2
+#define OUTPUT_DRY_RIGHT 3
+#define OUTPUT_STEM 4 /* the first of OUTPUT_N_STEMS */
+#define N_OUTPUTS (OUTPUT_STEM + OUTPUT_N_STEMS)
+
+/* what the governor gives up, each tier along with those before it */
+#define TIER_FULL 0
+#define TIER_BODY 1 /* the body cut to GOVERNOR_N_PARTITIONS, growing back once given up */
+#define TIER_SYMPATHETIC 2 /* no strings woken by the others, those ringing still hear them */
+#define TIER_STEAL 3 /* the strings quieter than GOVERNOR_FLOOR retired */
+#define TIER_OVERSAMPLE 4 /* the strings waking from then on run at the rate */
+#define N_TIERS 5
+
+static const char *paths_impulse_response[] = { PATHS_IMPULSE_RESPONSE };
+
+/* xorshift, so that the audio thread can draw noise without the shared state of rand */
+static double noise_next (uint32_t *state) {
+
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x / (double) UINT32_MAX;
 }
 
 static double lerp (double x, double a, double b) {
@@ -52,620 +190,6929 @@ static double interpolate_exponential (double x, double exp, double a, double b)
     return lerp (pow (x, exp), a, b);
 }
 
+static double decibels_to_amplitude (double decibels) {
+
+    return pow (10, decibels / 20);
+}
+
 typedef struct buffer_t {
 
     size_t n_samples;
-    double *data;
+    sample_t *data;
 
 } buffer_t;
 
-void buffer_init (buffer_t *buffer, size_t n_samples, double *data) {
+void buffer_init (buffer_t *buffer, size_t n_samples, sample_t *data) {
 
     buffer->n_samples = n_samples;
     buffer->data = data;
 }
 
-void buffer_load (buffer_t *buffer, char *path) {
+/* a whole file mapped read only, its pages shared with everyone else mapping it */
+typedef struct mapping_t {
 
-    FILE *stream;
-    size_t n_samples;
-    double *data;
+    size_t n_bytes;
+    const unsigned char *data;
 
-    if (!(stream = fopen (path, "rb"))) {
+} mapping_t;
 
-        fprintf (stderr, "cldnt open da file %s... 😭\n", path);
-        exit (EXIT_FAILURE);
-    }
+bool mapping_open (mapping_t *mapping, const char *path) {
 
-    fseek (stream, 0, SEEK_END);
-    n_samples = ftell (stream) / sizeof (double);
-    rewind (stream);
+    int descriptor;
+    struct stat status;
+    void *data;
 
-    data = calloc (n_samples, sizeof (double));
-    fread (data, sizeof (double), n_samples, stream);
+    memset (mapping, 0, sizeof (mapping_t));
 
-    fclose (stream);
+    if ((descriptor = open (path, O_RDONLY)) < 0)
+        return false;
 
-    buffer_init (buffer, n_samples, data);
-}
+    if (fstat (descriptor, &status) || !status.st_size) {
 
-void buffer_terminate (buffer_t *buffer) {
+        close (descriptor);
+        return false;
+    }
 
-    free (buffer->data);
+    data = mmap (NULL, status.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+    close (descriptor);
+    if (data == MAP_FAILED)
+        return false;
+
+    mapping->n_bytes = status.st_size;
+    mapping->data = data;
+    return true;
 }
 
-typedef struct filter_t {
+void mapping_close (mapping_t *mapping) {
 
-    double state;
-    double coefficient;
+    if (mapping->data)
+        munmap ((void *) mapping->data, mapping->n_bytes);
+}
 
-} filter_t;
+static unsigned long read_little_endian (const unsigned char *pointer, size_t n_bytes) {
 
-void filter_init (filter_t *filter) {
+    unsigned long value = 0;
 
-    memset (filter, 0, sizeof (filter_t));
+    while (n_bytes--)
+        value = (value << 8) | pointer[n_bytes];
+
+    return value;
 }
 
-void filter_terminate (filter_t *filter) {
+/* one sample of a wav file, pcm of 8 to 32 bits or float of 32 or 64 */
+static double wav_sample (const unsigned char *pointer, unsigned long type, unsigned long n_bits) {
 
-}
+    unsigned long value;
 
-void filter_cutoff_set (filter_t *filter, double cutoff, double rate) {
+    if (type == 3) {
 
-    double dc_constant = 1.0 / (2 * M_PI * cutoff);
-    filter->coefficient = 1 - exp (-1 / rate / dc_constant);
-}
+        float sample_float;
+        double sample_double;
 
-double filter_process (filter_t *filter, double input) {
+        if (n_bits == 32) {
 
-    return filter->state += filter->coefficient * (input - filter->state);
-}
+            memcpy (&sample_float, pointer, sizeof (float));
+            return sample_float;
+        }
 
-double filter_process_high_pass (filter_t *filter, double input) {
+        memcpy (&sample_double, pointer, sizeof (double));
+        return sample_double;
+    }
 
-    return input - filter_process (filter, input);
+    value = read_little_endian (pointer, n_bits / 8);
+    if (n_bits == 8)
+        return (value - 128.0) / 128.0;
+    return (value - (double) (value >> (n_bits - 1)) * ldexp (1, n_bits)) / ldexp (1, n_bits - 1);
 }
 
-typedef struct delay_t {
+/* at the rate of its header, the channels mixed down */
+static bool buffer_load_wav (buffer_t *buffer, double *rate, const unsigned char *data, size_t n_bytes) {
+
+    const unsigned char *pointer = data + 12;
+    const unsigned char *end = data + n_bytes;
+    const unsigned char *format = NULL;
+    const unsigned char *samples = NULL;
+    unsigned long size_format = 0;
+    unsigned long n_bytes_samples = 0;
+    unsigned long type;
+    unsigned long n_channels;
+    unsigned long n_bits;
+    size_t size_frame;
+    size_t n_samples;
+    size_t i;
 
-    double *buffer_head;
-    double *buffer_tail;
-    double *buffer_pointer;
+    while (end - pointer >= 8) {
 
-    size_t n_samples;
+        unsigned long size = read_little_endian (pointer + 4, 4);
+        if (size > (unsigned long) (end - pointer - 8))
+            size = end - pointer - 8; /* truncated, keep what is there */
 
-} delay_t;
+        if (!memcmp (pointer, "fmt ", 4)) {
 
-void delay_init (delay_t *delay, size_t n_samples) {
+            format = pointer + 8;
+            size_format = size;
 
-    delay->buffer_head = calloc (n_samples, sizeof (double));
-    delay->buffer_tail = delay->buffer_head + n_samples;
-    delay->buffer_pointer = delay->buffer_head;
-    delay->n_samples = n_samples;
-}
+        } else if (!memcmp (pointer, "data", 4)) {
 
-void delay_terminate (delay_t *delay) {
+            samples = pointer + 8;
+            n_bytes_samples = size;
+        }
 
-    free (delay->buffer_head);
-}
+        pointer += 8 + size + (size & 1);
+    }
 
-void delay_length_set (delay_t *delay, size_t n_samples) {
+    if (!format || size_format < 16 || !samples)
+        return false;
 
-    double *buffer_tail_old = delay->buffer_tail;
-    delay->buffer_tail = delay->buffer_head + n_samples;
-    if (delay->buffer_tail > buffer_tail_old)
-        memset (buffer_tail_old, 0, sizeof (double) * (delay->buffer_tail - buffer_tail_old));
-    delay->n_samples = n_samples;
-}
+    type = read_little_endian (format, 2);
+    n_channels = read_little_endian (format + 2, 2);
+    *rate = read_little_endian (format + 4, 4);
+    n_bits = read_little_endian (format + 14, 2);
+    if (type == 0xfffe && size_format >= 26) /* extensible, the type leads the subformat */
+        type = read_little_endian (format + 24, 2);
 
-void delay_period_set (delay_t *delay, double frequency, double rate) {
+    if (!n_channels || !*rate || !n_bits || n_bits % 8
+        || !((type == 1 && n_bits <= 32) || (type == 3 && (n_bits == 32 || n_bits == 64))))
+        return false;
 
-    delay_length_set (delay, rate / frequency);
-}
+    size_frame = n_channels * n_bits / 8;
+    n_samples = n_bytes_samples / size_frame;
+    buffer_init (buffer, n_samples, calloc (n_samples, sizeof (sample_t)));
 
-void delay_process (delay_t *delay, double input) {
+    for (i = 0; i < n_samples; i++) {
 
-    *(delay->buffer_pointer++) = input;
-    if (delay->buffer_pointer >= delay->buffer_tail)
-        delay->buffer_pointer -= delay->buffer_tail - delay->buffer_head;
-}
+        unsigned long j;
+        double sum = 0;
 
-typedef struct convolver_t {
+        for (j = 0; j < n_channels; j++)
+            sum += wav_sample (samples + i * size_frame + j * n_bits / 8, type, n_bits);
+        buffer->data[i] = sum / n_channels;
+    }
 
-    size_t i_sample;
-    buffer_t impulse_response;
-    delay_t memory;
+    return true;
+}
 
-} convolver_t;
+/* a wav file, or raw doubles at IMPULSE_RESPONSE_RATE like the .pcm files */
+bool buffer_load (buffer_t *buffer, double *rate, const char *path) {
 
-void convolver_init (convolver_t *convolver, char *path_impulse_response) {
+    mapping_t mapping;
+    bool loaded = true;
 
-    memset (convolver, 0, sizeof (convolver_t));
-    buffer_load (&convolver->impulse_response, path_impulse_response);
-    delay_init (&convolver->memory, convolver->impulse_response.n_samples);
-}
+    if (!mapping_open (&mapping, path)) {
 
-void convolver_terminate (convolver_t *convolver) {
+        fprintf (stderr, "cldnt open da file %s... 😭\n", path);
+        return false;
+    }
 
-    buffer_terminate (&convolver->impulse_response);
-    delay_terminate (&convolver->memory);
-}
+    if (mapping.n_bytes >= 12 && !memcmp (mapping.data, "RIFF", 4) && !memcmp (mapping.data + 8, "WAVE", 4)) {
 
-double convolver_process (convolver_t *convolver, double input) {
+        loaded = buffer_load_wav (buffer, rate, mapping.data, mapping.n_bytes);
 
-    size_t i;
-    double output = 0;
+    } else {
 
-    delay_process (&convolver->memory, input);
+        size_t i;
+        size_t n_samples = mapping.n_bytes / sizeof (double);
 
-    for (i = 0; i < convolver->impulse_response.n_samples; i++) {
+        /* stored as doubles whatever the precision */
+        buffer_init (buffer, n_samples, calloc (n_samples, sizeof (sample_t)));
+        for (i = 0; i < n_samples; i++) {
 
-        int i_sample = convolver->i_sample - i;
-        while (i_sample < 0) {
-            i_sample += convolver->impulse_response.n_samples;
+            double sample;
+            memcpy (&sample, mapping.data + i * sizeof (double), sizeof (double));
+            buffer->data[i] = sample;
         }
-        output += convolver->impulse_response.data[i]
-                * convolver->memory.buffer_head[i_sample];
+        *rate = IMPULSE_RESPONSE_RATE;
     }
 
-    convolver->i_sample = (convolver->i_sample + 1) % convolver->memory.n_samples;
+    mapping_close (&mapping);
 
-    return output;
+    if (!loaded)
+        fprintf (stderr, "cant make sense of %s... 😭\n", path);
+
+    return loaded;
 }
 
-typedef struct bridge_t {
+/* windowed sinc interpolation to ratio times the rate, into a new buffer,
+ * scaled so that the buffer still sums to the same response */
+void buffer_resample (buffer_t *output, const buffer_t *input, double ratio) {
 
-    filter_t filter;
-    double coefficient_bypass;
+    size_t i;
+    size_t n_samples = ceil (input->n_samples * ratio);
+    double cutoff = ratio < 1 ? ratio : 1;      /* of the input nyquist */
+    double width = RESAMPLE_N_ZEROS / cutoff;   /* input samples on either side */
+    sample_t *data = calloc (n_samples, sizeof (sample_t));
 
-} bridge_t;
+    buffer_init (output, n_samples, data);
 
-void bridge_init (bridge_t *bridge, double coefficient_bypass) {
+    if (ratio == 1) {
 
-    filter_init (&bridge->filter);
-    bridge->coefficient_bypass = coefficient_bypass;
-}
+        memcpy (data, input->data, sizeof (sample_t) * n_samples);
+        return;
+    }
 
-void bridge_terminate (bridge_t *bridge) {
+    for (i = 0; i < n_samples; i++) {
 
-    filter_terminate (&bridge->filter);
-}
+        long j;
+        double center = i / ratio;
+        long first = ceil (center - width);
+        long last = floor (center + width);
+        double sum = 0;
 
-void bridge_cutoff_set (bridge_t *bridge, double cutoff, double rate) {
+        if (first < 0)
+            first = 0;
+        if (last > (long) input->n_samples - 1)
+            last = (long) input->n_samples - 1;
 
-    filter_cutoff_set (&bridge->filter, cutoff, rate);
-}
+        for (j = first; j <= last; j++) {
 
-double bridge_process (bridge_t *bridge, double input) {
+            double x = (j - center) * cutoff;
+            double sinc = x == 0 ? 1 : sin (M_PI * x) / (M_PI * x);
+            double window = 0.5 + 0.5 * cos (M_PI * (j - center) / width);
+            sum += input->data[j] * cutoff * sinc * window;
+        }
 
-    double bypass = bridge->coefficient_bypass * input;
-    return filter_process (&bridge->filter, input - bypass);
+        data[i] = sum / ratio;
+    }
 }
 
-typedef struct voice_t {
+void buffer_terminate (buffer_t *buffer) {
 
-    delay_t delay;
-    filter_t filter_dc_blocker;
-    filter_t filter_damper;
-    filter_t filter_finger;
-    filter_t filter_transition_damper;
-    filter_t filter_transition_finger;
-    bridge_t bridge_input;
-    bridge_t bridge_output;
-    double frequency;
-    double cutoff_bridge;
-    double output;
-    double target_coefficient_damper;
-    double target_coefficient_finger;
-    double coefficient_transition_finger;
-    double sustain;
+    free (buffer->data);
+}
 
-    double rate;
+/* single producer single consumer queue of fixed size records,
+ * neither side ever blocks or allocates */
+typedef struct ring_t {
 
-} voice_t;
+    size_t n_records;           /* power of 2 */
+    size_t size_record;
+    unsigned char *data;
+    size_t i_write;             /* free running, wrapped on access */
+    size_t i_read;
 
-void voice_init (voice_t *voice, int note) {
+} ring_t;
 
-    double bypass;
-    memset (voice, 0, sizeof (voice_t));
-    voice->frequency = 440 * pow (2, (note - 69) / 12.0);
-    bypass = interpolate_exponential (note / 127.0,
-                                      2,
-                                      BRIDGE_COEFFICIENT_BYPASS_MIN,
-                                      BRIDGE_COEFFICIENT_BYPASS_MAX);
-    voice->cutoff_bridge = interpolate_exponential (note / 127.0,
-                                                    2,
-                                                    CUTOFF_BRIDGE_MIN,
-                                                    CUTOFF_BRIDGE_MAX);
-    delay_init (&voice->delay, N_DELAY_SAMPLES);
-    filter_init (&voice->filter_dc_blocker);
-    filter_init (&voice->filter_damper);
-    filter_init (&voice->filter_finger);
-    filter_init (&voice->filter_transition_damper);
-    filter_init (&voice->filter_transition_finger);
-    bridge_init (&voice->bridge_input, bypass);
-    bridge_init (&voice->bridge_output, bypass);
-    voice->target_coefficient_damper = 0;
-    voice->target_coefficient_finger = 0;
-    voice->coefficient_transition_finger = COEFFICIENT_TRANSITION_FINGER_MAX;
-    voice->sustain = 1;
+void ring_init (ring_t *ring, size_t n_records, size_t size_record) {
+
+    memset (ring, 0, sizeof (ring_t));
+    ring->n_records = n_records;
+    ring->size_record = size_record;
+    ring->data = calloc (n_records, size_record);
 }
 
-void voice_terminate (voice_t *voice) {
+void ring_terminate (ring_t *ring) {
 
-    delay_terminate (&voice->delay);
-    filter_terminate (&voice->filter_dc_blocker);
-    filter_terminate (&voice->filter_damper);
-    filter_terminate (&voice->filter_finger);
-    filter_terminate (&voice->filter_transition_damper);
-    filter_terminate (&voice->filter_transition_finger);
-    bridge_terminate (&voice->bridge_input);
-    bridge_terminate (&voice->bridge_output);
+    free (ring->data);
 }
 
-void voice_update (voice_t *voice) {
+/* the next record to fill, NULL if the ring is full */
+void *ring_reserve (ring_t *ring) {
 
-    delay_period_set (&voice->delay, voice->frequency, voice->rate);
-    filter_cutoff_set (&voice->filter_dc_blocker, CUTOFF_DC_BLOCKER, voice->rate);
-    filter_cutoff_set (&voice->filter_damper, CUTOFF_DAMPER, voice->rate);
-    filter_cutoff_set (&voice->filter_finger, CUTOFF_FINGER, voice->rate);
-    filter_cutoff_set (&voice->filter_transition_damper, COEFFICIENT_TRANSITION_DAMPER, voice->rate);
-    filter_cutoff_set (&voice->filter_transition_finger, voice->coefficient_transition_finger, voice->rate);
-    bridge_cutoff_set (&voice->bridge_input, voice->cutoff_bridge, voice->rate);
-    bridge_cutoff_set (&voice->bridge_output, voice->cutoff_bridge, voice->rate);
+    size_t i_read = __atomic_load_n (&ring->i_read, __ATOMIC_ACQUIRE);
+
+    if (ring->i_write - i_read == ring->n_records)
+        return NULL;
+    return ring->data + (ring->i_write & (ring->n_records - 1)) * ring->size_record;
 }
 
-void voice_rate_set (voice_t *voice, double rate) {
+/* publishes the record returned by ring_reserve */
+void ring_commit (ring_t *ring) {
 
-    voice->rate = rate;
-    voice_update (voice);
+    __atomic_store_n (&ring->i_write, ring->i_write + 1, __ATOMIC_RELEASE);
 }
 
-void voice_process (voice_t *voice, double input) {
+/* the oldest record, NULL if the ring is empty */
+void *ring_peek (ring_t *ring) {
 
-    double target_coefficient_finger;
-    double coefficient_damper;
-    double coefficient_finger;
-    double delay;
-    double dc_blocker;
-    double damper_damped;
-    double damper_undamped;
-    double reflection_damper;
-    double pre_termination;
-    double finger_damped;
-    double finger_undamped;
-    double reflection_finger;
-    double termination;
-    double reflection_bridge_output;
-    double transmission_bridge_input;
-
-    /* transitions */
-    target_coefficient_finger = voice->sustain * voice->target_coefficient_finger;
-    coefficient_damper = filter_process (&voice->filter_transition_damper,
-                                         voice->target_coefficient_damper);
-    coefficient_finger = filter_process (&voice->filter_transition_finger,
-                                         target_coefficient_finger);
-
-    /* dc blocker */
-    delay = *voice->delay.buffer_pointer;
-    dc_blocker = filter_process_high_pass (&voice->filter_dc_blocker, delay);
-
-    /* damper */
-    damper_damped = coefficient_damper * dc_blocker;
-    damper_undamped = dc_blocker - damper_damped;
-    reflection_damper = filter_process (&voice->filter_damper, damper_damped);
-    pre_termination = reflection_damper + damper_undamped;
-
-    /* finger */
-    finger_damped = coefficient_finger * pre_termination;
-    finger_undamped = pre_termination - finger_damped;
-    reflection_finger = filter_process (&voice->filter_finger, finger_damped);
-    termination = reflection_finger + finger_undamped;
+    size_t i_write = __atomic_load_n (&ring->i_write, __ATOMIC_ACQUIRE);
 
-    /* termination */
-    reflection_bridge_output = bridge_process (&voice->bridge_output, termination);
-    voice->output = termination - reflection_bridge_output;
-    transmission_bridge_input = bridge_process (&voice->bridge_input, input);
-    delay_process (&voice->delay, transmission_bridge_input + reflection_bridge_output);
+    if (i_write == ring->i_read)
+        return NULL;
+    return ring->data + (ring->i_read & (ring->n_records - 1)) * ring->size_record;
 }
 
-static void voice_excite (voice_t *voice, double velocity) {
+/* hands the record returned by ring_peek back to the producer */
+void ring_pop (ring_t *ring) {
 
-    double hammer_strike_position = HAMMER_STRIKE_POSITION_CENTER
-                                  + HAMMER_STRIKE_POSITION_VARIATION
-                                  * (noise () * 2 - 1);
+    __atomic_store_n (&ring->i_read, ring->i_read + 1, __ATOMIC_RELEASE);
+}
 
-    size_t i;
-    for (i = 0; i < voice->delay.n_samples; i++) {
+typedef struct filter_t {
 
-        double position = i / (double) voice->delay.n_samples * 2;
-        double sample = velocity;
+    state_t state;
+    state_t coefficient;
 
-        if (position > 1) {
+} filter_t;
 
-            position = 2 - position;
-            sample = -velocity;
-        }
+void filter_init (filter_t *filter) {
 
-        if (position < hammer_strike_position)
-            sample *= position / hammer_strike_position;
-        else
-            sample *= 1 - (position - hammer_strike_position) / (1 - hammer_strike_position);
+    memset (filter, 0, sizeof (filter_t));
+}
+
+void filter_terminate (filter_t *filter) {
 
-        delay_process (&voice->delay, *voice->delay.buffer_pointer + sample / 2);
-    }
 }
 
-void voice_note_on (voice_t *voice, double velocity) {
+double filter_coefficient (double cutoff, double rate) {
 
-    double velocity_normalized = velocity / 127.0;
-    voice->target_coefficient_finger = 0;
-    voice->filter_transition_finger.state = 1;
-    voice_excite (voice, velocity_normalized);
-    voice->coefficient_transition_finger
-        = interpolate_exponential (velocity_normalized,
-                                   COEFFICIENT_TRANSITION_FINGER_INTERPOLATION_EXPONENT,
-                                   COEFFICIENT_TRANSITION_FINGER_MIN,
-                                   COEFFICIENT_TRANSITION_FINGER_MAX);
-    voice_update (voice);
+    double dc_constant = 1.0 / (2 * M_PI * cutoff);
+    return 1 - exp (-1 / rate / dc_constant);
 }
 
-void voice_note_off (voice_t *voice, double velocity) {
+void filter_cutoff_set (filter_t *filter, double cutoff, double rate) {
 
-    voice->target_coefficient_finger = 1;
-    voice->coefficient_transition_finger = COEFFICIENT_TRANSITION_FINGER_NOTE_OFF;
-    voice_update (voice);
+    filter->coefficient = filter_coefficient (cutoff, rate);
 }
 
-void voice_damper_set (voice_t *voice, double damper) {
+state_t filter_process (filter_t *filter, state_t input) {
 
-    voice->target_coefficient_damper = damper;
+    return filter->state += filter->coefficient * (input - filter->state);
 }
 
-void voice_sustain_set (voice_t *voice, double sustain) {
+state_t filter_process_high_pass (filter_t *filter, state_t input) {
 
-    voice->sustain = sustain;
+    return input - filter_process (filter, input);
 }
 
-typedef struct resonator_t {
+/* a ring of fixed capacity over memory owned by someone else, written at
+ * buffer_pointer and read n_samples behind it, so the length can change at
+ * any time without moving or clearing anything */
+typedef struct delay_t {
 
-    convolver_t convolver;
+    sample_t *buffer_head;
+    sample_t *buffer_tail;
+    sample_t *buffer_pointer;     /* next sample written */
 
-} resonator_t;
+    size_t n_samples;
+
+} delay_t;
 
-void resonator_init (resonator_t *resonator) {
+void delay_init (delay_t *delay, size_t n_samples_max, sample_t *buffer) {
 
-    memset (resonator, 0, sizeof (resonator_t));
-    convolver_init (&resonator->convolver, PATH_IMPULSE_RESPONSE);
+    delay->buffer_head = buffer;
+    delay->buffer_tail = delay->buffer_head + n_samples_max;
+    delay->buffer_pointer = delay->buffer_head;
+    delay->n_samples = n_samples_max;
 }
 
-void resonator_terminate (resonator_t *resonator) {
+void delay_terminate (delay_t *delay) {
 
-    convolver_terminate (&resonator->convolver);
 }
 
-double resonator_process (resonator_t *resonator, double input) {
+void delay_length_set (delay_t *delay, size_t n_samples) {
 
-    return lerp (RESONANCE_BODY, input, convolver_process (&resonator->convolver, input));
+    size_t n_samples_max = delay->buffer_tail - delay->buffer_head;
+    delay->n_samples = n_samples < n_samples_max ? n_samples : n_samples_max;
 }
 
-typedef struct synth_t {
+/* the sample read i samples from now, negative i for ones already read */
+sample_t *delay_tap (delay_t *delay, long i) {
 
-    voice_t voices[N_VOICES];
-    resonator_t resonator;
+    long n_samples_max = delay->buffer_tail - delay->buffer_head;
+    long i_sample = (delay->buffer_pointer - delay->buffer_head) - (long) delay->n_samples + i;
 
-    double bend;
+    i_sample %= n_samples_max;
+    if (i_sample < 0)
+        i_sample += n_samples_max;
+    return delay->buffer_head + i_sample;
+}
 
-    double rate;
-    double delta_time;
+void delay_process (delay_t *delay, sample_t input) {
 
-} synth_t;
+    *(delay->buffer_pointer++) = input;
+    if (delay->buffer_pointer >= delay->buffer_tail)
+        delay->buffer_pointer -= delay->buffer_tail - delay->buffer_head;
+}
 
-void synth_init (synth_t *synth) {
+/* the whole samples of a delay_t for a delay of length samples, leaving a
+ * fraction in the range where the interpolator is most accurate */
+size_t delay_length_whole (double length) {
+
+    double whole = floor (length - (DELAY_INTERPOLATION_ORDER - 1) / 2.0);
+    return whole < 1 ? 1 : whole;
+}
+
+/* lagrange interpolator delaying by fraction samples,
+ * the coefficients of the newest tap first */
+void delay_interpolation_set (state_t *coefficients, double fraction) {
 
     size_t i;
 
-    memset (synth, 0, sizeof (synth_t));
+    for (i = 0; i <= DELAY_INTERPOLATION_ORDER; i++) {
 
-    for (i = 0; i < N_VOICES; i++)
-        voice_init (&synth->voices[i], i);
+        size_t j;
 
-    resonator_init (&synth->resonator);
+        coefficients[i] = 1;
+        for (j = 0; j <= DELAY_INTERPOLATION_ORDER; j++)
+            if (j != i)
+                coefficients[i] *= (fraction - j) / ((double) i - j);
+    }
 }
 
-void synth_terminate (synth_t *synth) {
+typedef struct fft_t {
+
+    size_t n_points;
+    size_t *bit_reversal;
+    sample_t *twiddle_real;
+    sample_t *twiddle_imaginary;
+
+} fft_t;
+
+void fft_init (fft_t *fft, size_t n_points) {
 
     size_t i;
+    size_t n_bits = 0;
 
-    for (i = 0; i < N_VOICES; i++)
-        voice_terminate (&synth->voices[i]);
+    while (((size_t) 1 << n_bits) < n_points)
+        n_bits++;
 
-    resonator_terminate (&synth->resonator);
-}
+    fft->n_points = n_points;
+    fft->bit_reversal = calloc (n_points, sizeof (size_t));
+    fft->twiddle_real = calloc (n_points / 2, sizeof (sample_t));
+    fft->twiddle_imaginary = calloc (n_points / 2, sizeof (sample_t));
 
-static void synth_update (synth_t *synth) {
+    for (i = 0; i < n_points; i++) {
 
-    size_t i;
+        size_t j;
+        size_t reversed = 0;
+        for (j = 0; j < n_bits; j++)
+            reversed |= ((i >> j) & 1) << (n_bits - 1 - j);
+        fft->bit_reversal[i] = reversed;
+    }
 
-    for (i = 0; i < N_VOICES; i++)
-        voice_rate_set (&synth->voices[i], synth->rate);
+    for (i = 0; i < n_points / 2; i++) {
+
+        fft->twiddle_real[i] = cos (-2 * M_PI * i / n_points);
+        fft->twiddle_imaginary[i] = sin (-2 * M_PI * i / n_points);
+    }
 }
 
-void synth_process_audio (synth_t *synth,
-                          jack_nframes_t n_frames,
-                          jack_default_audio_sample_t *buffer) {
+void fft_terminate (fft_t *fft) {
+
+    free (fft->bit_reversal);
+    free (fft->twiddle_real);
+    free (fft->twiddle_imaginary);
+}
+
+/* in place radix 2, unscaled in both directions */
+void fft_process (fft_t *fft, sample_t *real, sample_t *imaginary, bool inverse) {
 
     size_t i;
+    size_t size;
+    sample_t sign = inverse ? -1 : 1;
 
-    for (i = 0; i < n_frames; i++) {
+    for (i = 0; i < fft->n_points; i++) {
 
-        size_t j;
+        size_t j = fft->bit_reversal[i];
+        if (j > i) {
 
-        /* TODO
-         * learn abt coupling between transverse planes n longitudinal 
-         * due to the bridge ?????? */
+            sample_t swap_real = real[i];
+            sample_t swap_imaginary = imaginary[i];
+            real[i] = real[j];
+            imaginary[i] = imaginary[j];
+            real[j] = swap_real;
+            imaginary[j] = swap_imaginary;
+        }
+    }
 
-        double output_resonator;
-        double reflection;
-        double distributed;
+    for (size = 2; size <= fft->n_points; size <<= 1) {
 
-        double output_sum_voices = 0;
-        for (j = VOICE_MIN; j < VOICE_MAX; j++)
-            output_sum_voices += synth->voices[j].output;
+        size_t half = size / 2;
+        size_t stride = fft->n_points / size;
+        size_t start;
 
-        reflection = SYMPATHETIC_RESONANCE * output_sum_voices;
-        distributed = reflection / N_VOICES;
+        for (start = 0; start < fft->n_points; start += size) {
 
-        for (j = VOICE_MIN; j < VOICE_MAX; j++)
-            voice_process (&synth->voices[j], distributed);
+            size_t j;
+            for (j = 0; j < half; j++) {
 
-        output_resonator = resonator_process (&synth->resonator, output_sum_voices);
-        buffer[i] = VOLUME * output_resonator;
+                sample_t w_real = fft->twiddle_real[j * stride];
+                sample_t w_imaginary = sign * fft->twiddle_imaginary[j * stride];
+                size_t a = start + j;
+                size_t b = a + half;
+                sample_t t_real = w_real * real[b] - w_imaginary * imaginary[b];
+                sample_t t_imaginary = w_real * imaginary[b] + w_imaginary * real[b];
+                real[b] = real[a] - t_real;
+                imaginary[b] = imaginary[a] - t_imaginary;
+                real[a] += t_real;
+                imaginary[a] += t_imaginary;
+            }
+        }
     }
 }
 
-void synth_process_midi_note_off (synth_t *synth, int channel, int note, int velocity) {
-
-    voice_note_off (&synth->voices[note], velocity);
-}
+/* an impulse response cut into partitions and transformed, ready to be
+ * convolved with; never changed once made, so it can be handed between threads */
+typedef struct kernel_t {
 
-void synth_process_midi_note_on (synth_t *synth, int channel, int note, int velocity) {
+    size_t n_partitions;
+    sample_t *head;                 /* first partition, time reversed */
+    sample_t *partitions_real;      /* n_partitions * n_bins */
+    sample_t *partitions_imaginary;
+    bool mapped;                    /* the data belongs to a bank_t or another kernel, see kernel_share */
 
-    voice_note_on (&synth->voices[note], velocity);
-}
+} kernel_t;
 
-void synth_process_midi_cc (synth_t *synth, int channel, int controller, int value) {
+/* allocates, so never on the process thread */
+kernel_t *kernel_create (const buffer_t *impulse_response) {
 
     size_t i;
+    size_t n_points = 2 * CONVOLVER_PARTITION_SIZE;
+    size_t n_bins = n_points / 2 + 1;
+    sample_t *data = impulse_response->data;
+    size_t n_samples = impulse_response->n_samples;
+    sample_t *scratch_real = calloc (n_points, sizeof (sample_t));
+    sample_t *scratch_imaginary = calloc (n_points, sizeof (sample_t));
+    kernel_t *kernel = calloc (1, sizeof (kernel_t));
+    fft_t fft;
 
-    switch (controller) {
+    fft_init (&fft, n_points);
+    kernel->n_partitions = n_samples > CONVOLVER_PARTITION_SIZE
+                         ? (n_samples - 1) / CONVOLVER_PARTITION_SIZE
+                         : 0;
 
-        case 1: /* modulation wheel */
-            for (i = 0; i < N_VOICES; i++)
-                voice_damper_set (&synth->voices[i], value / 127.0);
-            break;
+    kernel->head = calloc (CONVOLVER_PARTITION_SIZE, sizeof (sample_t));
+    for (i = 0; i < CONVOLVER_PARTITION_SIZE && i < n_samples; i++)
+        kernel->head[CONVOLVER_PARTITION_SIZE - 1 - i] = data[i];
 
-        case 11: /* expression */
-            break;
+    kernel->partitions_real = calloc (kernel->n_partitions * n_bins, sizeof (sample_t));
+    kernel->partitions_imaginary = calloc (kernel->n_partitions * n_bins, sizeof (sample_t));
 
-        case 64: /* sustain pedal */
-            for (i = 0; i < N_VOICES; i++)
-                voice_sustain_set (&synth->voices[i], value / 127.0);
-            break;
+    for (i = 0; i < kernel->n_partitions; i++) {
+
+        size_t j;
+        size_t offset = (i + 1) * CONVOLVER_PARTITION_SIZE;
+
+        memset (scratch_real, 0, sizeof (sample_t) * n_points);
+        memset (scratch_imaginary, 0, sizeof (sample_t) * n_points);
+        for (j = 0; j < CONVOLVER_PARTITION_SIZE && offset + j < n_samples; j++)
+            scratch_real[j] = data[offset + j];
+
+        fft_process (&fft, scratch_real, scratch_imaginary, false);
+
+        /* fold the inverse transform scaling in here */
+        for (j = 0; j < n_bins; j++) {
+
+            kernel->partitions_real[i * n_bins + j] = scratch_real[j] / n_points;
+            kernel->partitions_imaginary[i * n_bins + j] = scratch_imaginary[j] / n_points;
+        }
     }
-}
 
-void synth_process_midi_bend (synth_t *synth, int channel, int lsb, int msb) {
+    fft_terminate (&fft);
+    free (scratch_real);
+    free (scratch_imaginary);
 
-    int value = (msb << 7) | lsb;
-    synth->bend = (value / (double) 0x2000 - 1) * BEND_RANGE;
+    return kernel;
 }
 
-void synth_process_midi (synth_t *synth, jack_midi_data_t *data) {
+void kernel_destroy (kernel_t *kernel) {
 
-    int status  = data[0] & 0xf0;
-    int channel = data[0] & 0x0f;
+    if (!kernel)
+        return;
 
-    switch (status) {
+    if (!kernel->mapped) {
 
-        case 0x80: /* note off */
-            printf ("note off: %x %x\n", data[1], data[2]);
-            synth_process_midi_note_off (synth, channel, data[1], data[2]);
-            break;
+        free (kernel->head);
+        free (kernel->partitions_real);
+        free (kernel->partitions_imaginary);
+    }
+    free (kernel);
+}
+
+/* another kernel on the data of kernel, which has to outlive it */
+kernel_t *kernel_share (const kernel_t *kernel) {
+
+    kernel_t *share = malloc (sizeof (kernel_t));
+
+    *share = *kernel;
+    share->mapped = true;
+    return share;
+}
+
+/* many bodies in one file, mapped rather than read so that opening it costs
+ * the same however many it holds, and every instance shares the pages;
+ * in host byte order: a bank_header_t, the bank_entry_t of each body from
+ * BANK_ALIGNMENT on, then the blocks they point at, each aligned as well:
+ * the samples of each body, and its kernel for each rate of the header
+ * laid out as in kernel_t, head then partitions real then imaginary */
+typedef struct bank_header_t {
+
+    char magic[8];                  /* BANK_MAGIC */
+    uint32_t version;
+    uint32_t n_entries;
+    uint32_t size_sample;           /* 4 for float, 8 for double */
+    uint32_t size_partition;        /* the kernels are only any use with the same CONVOLVER_PARTITION_SIZE */
+    uint32_t n_rates;
+    uint32_t rates[BANK_N_RATES_MAX];
+
+} bank_header_t;
+
+typedef struct bank_kernel_t {
+
+    uint64_t offset;                /* 0 for none */
+    uint64_t n_partitions;
+
+} bank_kernel_t;
+
+typedef struct bank_entry_t {
+
+    char name[BANK_SIZE_NAME];      /* of the file it was made from */
+    double rate;
+    uint32_t n_channels;            /* 1, the source is mixed down */
+    uint32_t reserved;
+    uint64_t n_samples;
+    uint64_t offset;
+    bank_kernel_t kernels[BANK_N_RATES_MAX]; /* by rate of the header */
+
+} bank_entry_t;
+
+typedef struct bank_t {
+
+    mapping_t mapping;
+    const bank_header_t *header;    /* NULL while none is open */
+    const bank_entry_t *entries;
+    bool kernels;                   /* made with the same sample_t and partitions as this build */
+
+} bank_t;
+
+static size_t bank_align (size_t offset) {
+
+    return (offset + BANK_ALIGNMENT - 1) / BANK_ALIGNMENT * BANK_ALIGNMENT;
+}
+
+static bool bank_block_valid (const bank_t *bank, uint64_t offset, uint64_t n_values, size_t size_value) {
+
+    size_t n_bytes = bank->mapping.n_bytes;
+
+    return offset && offset % BANK_ALIGNMENT == 0 && offset <= n_bytes
+        && n_values <= (n_bytes - offset) / size_value;
+}
+
+static size_t bank_n_samples_kernel (uint64_t n_partitions) {
+
+    return CONVOLVER_PARTITION_SIZE + 2 * n_partitions * (CONVOLVER_PARTITION_SIZE + 1);
+}
+
+/* false without complaint if there is no such file */
+bool bank_open (bank_t *bank, const char *path) {
+
+    size_t i;
+    const bank_header_t *header;
+
+    memset (bank, 0, sizeof (bank_t));
+    if (!mapping_open (&bank->mapping, path))
+        return false;
+
+    header = (const bank_header_t *) bank->mapping.data;
+    if (bank->mapping.n_bytes < bank_align (sizeof (bank_header_t))
+        || memcmp (header->magic, BANK_MAGIC, sizeof (header->magic))
+        || header->version != BANK_VERSION
+        || (header->size_sample != sizeof (float) && header->size_sample != sizeof (double))
+        || header->n_rates > BANK_N_RATES_MAX
+        || header->n_entries > (bank->mapping.n_bytes - bank_align (sizeof (bank_header_t))) / sizeof (bank_entry_t))
+        goto invalid;
+
+    bank->header = header;
+    bank->entries = (const bank_entry_t *) (bank->mapping.data + bank_align (sizeof (bank_header_t)));
+    bank->kernels = header->size_sample == sizeof (sample_t) && header->size_partition == CONVOLVER_PARTITION_SIZE;
+
+    for (i = 0; i < header->n_entries; i++) {
+
+        size_t j;
+        const bank_entry_t *entry = &bank->entries[i];
+
+        if (entry->rate <= 0 || !bank_block_valid (bank, entry->offset, entry->n_samples, header->size_sample))
+            goto invalid;
+
+        for (j = 0; j < header->n_rates; j++) {
+
+            const bank_kernel_t *kernel = &entry->kernels[j];
+            if (kernel->offset
+                && (kernel->n_partitions > bank->mapping.n_bytes / header->size_sample
+                    || !bank_block_valid (bank, kernel->offset,
+                                          bank_n_samples_kernel (kernel->n_partitions), header->size_sample)))
+                goto invalid;
+        }
+    }
+
+    return true;
+
+invalid:
+    fprintf (stderr, "da bank %s is all wrong... 😭\n", path);
+    mapping_close (&bank->mapping);
+    memset (bank, 0, sizeof (bank_t));
+    return false;
+}
+
+void bank_close (bank_t *bank) {
+
+    mapping_close (&bank->mapping);
+}
+
+size_t bank_n_entries (const bank_t *bank) {
+
+    return bank->header ? bank->header->n_entries : 0;
+}
+
+/* the samples of entry i, converted into a buffer of their own */
+void bank_samples (const bank_t *bank, size_t i, buffer_t *buffer, double *rate) {
+
+    size_t j;
+    const bank_entry_t *entry = &bank->entries[i];
+    const unsigned char *data = bank->mapping.data + entry->offset;
+
+    buffer_init (buffer, entry->n_samples, calloc (entry->n_samples, sizeof (sample_t)));
+    for (j = 0; j < entry->n_samples; j++)
+        buffer->data[j] = bank->header->size_sample == sizeof (float)
+                        ? ((const float *) data)[j]
+                        : ((const double *) data)[j];
+    *rate = entry->rate;
+}
+
+/* the kernel of entry i made ahead for rate, pointing into the bank,
+ * NULL if there is none usable; allocates, so never on the process thread */
+kernel_t *bank_kernel (const bank_t *bank, size_t i, double rate) {
+
+    size_t j;
+    const bank_entry_t *entry = &bank->entries[i];
+
+    if (!bank->kernels)
+        return NULL;
+
+    for (j = 0; j < bank->header->n_rates; j++) {
+
+        const bank_kernel_t *prepared = &entry->kernels[j];
+
+        if (bank->header->rates[j] == rate && prepared->offset) {
+
+            kernel_t *kernel = calloc (1, sizeof (kernel_t));
+            sample_t *data = (sample_t *) (bank->mapping.data + prepared->offset);
+
+            kernel->n_partitions = prepared->n_partitions;
+            kernel->head = data;
+            kernel->partitions_real = data + CONVOLVER_PARTITION_SIZE;
+            kernel->partitions_imaginary = kernel->partitions_real
+                                         + prepared->n_partitions * (CONVOLVER_PARTITION_SIZE + 1);
+            kernel->mapped = true;
+            return kernel;
+        }
+    }
+
+    return NULL;
+}
+
+/* name under directory into path, false if it would not fit */
+static bool path_join (char *path, const char *directory, const char *name) {
+
+    if (strlen (directory) + strlen (name) >= SIZE_PATH) {
+
+        fprintf (stderr, "da path to %s is way too long... 😭\n", name);
+        return false;
+    }
+
+    strcpy (path, directory);
+    strcat (path, name);
+    return true;
+}
+
+/* how many programs there are, the bodies in bank if it holds any */
+static size_t bodies_n (const bank_t *bank) {
+
+    size_t n_entries = bank_n_entries (bank);
+    return n_entries ? n_entries : sizeof (paths_impulse_response) / sizeof (paths_impulse_response[0]);
+}
+
+/* the body of a program, from bank if it holds any and else from its file
+ * under directory, and which entry of the bank it was, -1 for none */
+static bool body_load (const bank_t *bank, const char *directory, int program,
+                       buffer_t *body, double *rate, long *entry) {
+
+    size_t i = program % bodies_n (bank);
+    char path[SIZE_PATH];
+
+    if (bank_n_entries (bank)) {
+
+        *entry = i;
+        bank_samples (bank, i, body, rate);
+        return true;
+    }
+
+    *entry = -1;
+    return path_join (path, directory, paths_impulse_response[i])
+        && buffer_load (body, rate, path);
+}
+
+/* a body at rate_body resampled and partitioned for rate,
+ * straight out of the bank if it was made ahead for it */
+static kernel_t *body_kernel (const bank_t *bank, long entry, const buffer_t *body, double rate_body, double rate) {
+
+    buffer_t resampled;
+    kernel_t *kernel;
+
+    if (entry >= 0 && (kernel = bank_kernel (bank, entry, rate)))
+        return kernel;
+
+    buffer_resample (&resampled, body, rate / rate_body);
+    kernel = kernel_create (&resampled);
+    buffer_terminate (&resampled);
+
+    return kernel;
+}
+
+/* the input spectra of the last n partitions, as many as the kernels
+ * convolved with them have partitions */
+typedef struct spectra_t {
+
+    size_t n;
+    sample_t *real;                 /* n * n_bins */
+    sample_t *imaginary;
+
+} spectra_t;
+
+/* allocates, so never on the process thread */
+spectra_t *spectra_create (size_t n, size_t n_bins) {
+
+    spectra_t *spectra = malloc (sizeof (spectra_t));
+
+    /* a single slot at least, for the newest */
+    spectra->n = n ? n : 1;
+    spectra->real = calloc (spectra->n * n_bins, sizeof (sample_t));
+    spectra->imaginary = calloc (spectra->n * n_bins, sizeof (sample_t));
+    return spectra;
+}
+
+void spectra_destroy (spectra_t *spectra) {
+
+    if (!spectra)
+        return;
+
+    free (spectra->real);
+    free (spectra->imaginary);
+    free (spectra);
+}
+
+/* the spectra of source from the newest at i_source on into the first slots
+ * of spectra, which holds at least as many, the newest first */
+static void spectra_copy (spectra_t *spectra, const spectra_t *source, size_t i_source, size_t n_bins) {
+
+    size_t n_wrapped = source->n - i_source;
+
+    memcpy (spectra->real, source->real + i_source * n_bins, sizeof (sample_t) * n_wrapped * n_bins);
+    memcpy (spectra->imaginary, source->imaginary + i_source * n_bins, sizeof (sample_t) * n_wrapped * n_bins);
+    memcpy (spectra->real + n_wrapped * n_bins, source->real, sizeof (sample_t) * i_source * n_bins);
+    memcpy (spectra->imaginary + n_wrapped * n_bins, source->imaginary, sizeof (sample_t) * i_source * n_bins);
+}
+
+/* uniformly partitioned overlap-save convolution with a zero latency head:
+ * the first partition of the impulse response is convolved directly,
+ * the remaining ones in the frequency domain once per partition;
+ * the kernel can be swapped from another thread while running,
+ * see convolver_kernel_post */
+typedef struct convolver_t {
+
+    fft_t fft;
+    size_t n_bins;
+
+    kernel_t *kernel;               /* silent while none */
+    kernel_t *kernel_fading;        /* the one kernel is taking over from */
+    size_t i_fade;
+    kernel_t *kernel_next;          /* posted, taken up at the next partition */
+    kernel_t *kernel_retired;       /* faded out, waiting to be collected */
+
+    spectra_t *spectra;             /* as long as the longest kernel taken up, newest at i_spectrum */
+    spectra_t *spectra_next;        /* a longer one posted along with a kernel */
+    spectra_t *spectra_retired;     /* outgrown, waiting to be collected */
+    size_t n_spectra_posted;        /* partitions of the longest one posted, by the posting thread */
+    size_t i_spectrum;
+
+    sample_t *window;               /* previous and current input partition */
+    sample_t *tail;                 /* frequency domain output for the current partition */
+    sample_t *tail_fading;          /* the same through kernel_fading */
+    sample_t *scratch_real;
+    sample_t *scratch_imaginary;
+    size_t i_sample;
+
+    size_t n_partitions;            /* of the kernels used, see convolver_partitions_limit */
+    size_t n_partitions_limit;
+
+} convolver_t;
+
+void convolver_init (convolver_t *convolver) {
+
+    size_t n_points = 2 * CONVOLVER_PARTITION_SIZE;
+
+    memset (convolver, 0, sizeof (convolver_t));
+
+    fft_init (&convolver->fft, n_points);
+    convolver->n_bins = n_points / 2 + 1;
+
+    /* grown to the kernels as they come, see convolver_kernel_post */
+    convolver->spectra = spectra_create (0, convolver->n_bins);
+    convolver->n_spectra_posted = convolver->spectra->n;
+    convolver->window = calloc (n_points, sizeof (sample_t));
+    convolver->tail = calloc (CONVOLVER_PARTITION_SIZE, sizeof (sample_t));
+    convolver->tail_fading = calloc (CONVOLVER_PARTITION_SIZE, sizeof (sample_t));
+    convolver->scratch_real = calloc (n_points, sizeof (sample_t));
+    convolver->scratch_imaginary = calloc (n_points, sizeof (sample_t));
+    convolver->n_partitions = convolver->n_partitions_limit = CONVOLVER_N_PARTITIONS_ALL;
+}
+
+void convolver_terminate (convolver_t *convolver) {
+
+    kernel_destroy (convolver->kernel);
+    kernel_destroy (convolver->kernel_fading);
+    kernel_destroy (convolver->kernel_next);
+    kernel_destroy (convolver->kernel_retired);
+    fft_terminate (&convolver->fft);
+    spectra_destroy (convolver->spectra);
+    spectra_destroy (convolver->spectra_next);
+    spectra_destroy (convolver->spectra_retired);
+    free (convolver->window);
+    free (convolver->tail);
+    free (convolver->tail_fading);
+    free (convolver->scratch_real);
+    free (convolver->scratch_imaginary);
+}
+
+/* swaps right away, never while processing; takes over the kernel */
+void convolver_kernel_set (convolver_t *convolver, kernel_t *kernel) {
+
+    if (kernel && kernel->n_partitions > convolver->spectra->n) {
+
+        spectra_t *spectra = spectra_create (kernel->n_partitions, convolver->n_bins);
+
+        spectra_copy (spectra, convolver->spectra, convolver->i_spectrum, convolver->n_bins);
+        spectra_destroy (convolver->spectra);
+        convolver->spectra = spectra;
+        convolver->i_spectrum = 0;
+    }
+    spectra_destroy (convolver->spectra_next);
+    spectra_destroy (convolver->spectra_retired);
+    convolver->spectra_next = NULL;
+    convolver->spectra_retired = NULL;
+    convolver->n_spectra_posted = convolver->spectra->n;
+
+    kernel_destroy (convolver->kernel);
+    kernel_destroy (convolver->kernel_fading);
+    kernel_destroy (convolver->kernel_next);
+    kernel_destroy (convolver->kernel_retired);
+    convolver->kernel = kernel;
+    convolver->kernel_fading = NULL;
+    convolver->kernel_next = NULL;
+    convolver->kernel_retired = NULL;
+}
+
+/* whether a posted kernel is still waiting to be taken up */
+bool convolver_kernel_pending (convolver_t *convolver) {
+
+    return __atomic_load_n (&convolver->kernel_next, __ATOMIC_ACQUIRE);
+}
+
+/* hands a kernel to the process thread to crossfade to, from a single other
+ * thread and only once the last one is no longer pending; takes it over,
+ * along with a history long enough for it if it is the longest yet */
+void convolver_kernel_post (convolver_t *convolver, kernel_t *kernel) {
+
+    if (kernel && kernel->n_partitions > convolver->n_spectra_posted) {
+
+        convolver->n_spectra_posted = kernel->n_partitions;
+        __atomic_store_n (&convolver->spectra_next, spectra_create (kernel->n_partitions, convolver->n_bins),
+                          __ATOMIC_RELAXED);
+    }
+
+    __atomic_store_n (&convolver->kernel_next, kernel, __ATOMIC_RELEASE);
+}
+
+/* frees the kernel faded out last and any history outgrown, from the thread posting them */
+void convolver_kernel_collect (convolver_t *convolver) {
+
+    kernel_destroy (__atomic_exchange_n (&convolver->kernel_retired, NULL, __ATOMIC_ACQUIRE));
+    spectra_destroy (__atomic_exchange_n (&convolver->spectra_retired, NULL, __ATOMIC_ACQUIRE));
+}
+
+/* cuts the kernels to their first n_partitions right away, or lets them grow
+ * back to it CONVOLVER_N_PARTITIONS_GROW partitions at a time, so that their
+ * tails fade back in rather than all at once; from the process thread */
+void convolver_partitions_limit (convolver_t *convolver, size_t n_partitions) {
+
+    convolver->n_partitions_limit = n_partitions;
+    if (convolver->n_partitions > n_partitions)
+        convolver->n_partitions = n_partitions;
+}
+
+/* the output of kernel for the next partition, out of the input spectra */
+static void convolver_process_tail (convolver_t *convolver, const kernel_t *kernel, sample_t *tail) {
+
+    size_t i;
+    size_t n_partitions;
+    size_t n_bins = convolver->n_bins;
+    size_t n_points = convolver->fft.n_points;
+    sample_t *real = convolver->scratch_real;
+    sample_t *imaginary = convolver->scratch_imaginary;
+
+    if (!kernel || !kernel->n_partitions || !convolver->n_partitions) {
+
+        memset (tail, 0, sizeof (sample_t) * CONVOLVER_PARTITION_SIZE);
+        return;
+    }
+
+    /* multiply accumulate partition i with the spectrum i partitions old */
+    n_partitions = kernel->n_partitions < convolver->n_partitions ? kernel->n_partitions : convolver->n_partitions;
+    memset (real, 0, sizeof (sample_t) * n_points);
+    memset (imaginary, 0, sizeof (sample_t) * n_points);
+    for (i = 0; i < n_partitions; i++) {
+
+        size_t j;
+        size_t i_spectrum = (convolver->i_spectrum + i) % convolver->spectra->n;
+        sample_t *h_real = kernel->partitions_real + i * n_bins;
+        sample_t *h_imaginary = kernel->partitions_imaginary + i * n_bins;
+        sample_t *x_real = convolver->spectra->real + i_spectrum * n_bins;
+        sample_t *x_imaginary = convolver->spectra->imaginary + i_spectrum * n_bins;
+
+        for (j = 0; j < n_bins; j++) {
+
+            real[j] += h_real[j] * x_real[j] - h_imaginary[j] * x_imaginary[j];
+            imaginary[j] += h_real[j] * x_imaginary[j] + h_imaginary[j] * x_real[j];
+        }
+    }
+
+    /* the input is real so the output spectrum is hermitian */
+    for (i = n_bins; i < n_points; i++) {
+
+        real[i] = real[n_points - i];
+        imaginary[i] = -imaginary[n_points - i];
+    }
+
+    fft_process (&convolver->fft, real, imaginary, true);
+    memcpy (tail, real + CONVOLVER_PARTITION_SIZE, sizeof (sample_t) * CONVOLVER_PARTITION_SIZE);
+}
+
+/* retires the kernel faded out and takes up a posted one, between partitions */
+static void convolver_process_swap (convolver_t *convolver) {
+
+    if (convolver->kernel_fading && convolver->i_fade == CONVOLVER_N_FADE) {
+
+        /* keeps running silently while the last one is still uncollected */
+        kernel_t *expected = NULL;
+        if (__atomic_compare_exchange_n (&convolver->kernel_retired, &expected, convolver->kernel_fading,
+                                         false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            convolver->kernel_fading = NULL;
+    }
+
+    if (!convolver->kernel_fading && __atomic_load_n (&convolver->kernel_next, __ATOMIC_ACQUIRE)) {
+
+        spectra_t *spectra = __atomic_load_n (&convolver->spectra_next, __ATOMIC_RELAXED);
+
+        /* a longer kernel brings a longer history, which takes over the one
+         * so far, the oldest slots silent; waits while the last is uncollected */
+        if (spectra) {
+
+            spectra_t *expected = NULL;
+            if (!__atomic_compare_exchange_n (&convolver->spectra_retired, &expected, convolver->spectra,
+                                              false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+                return;
+
+            spectra_copy (spectra, convolver->spectra, convolver->i_spectrum, convolver->n_bins);
+            convolver->spectra = spectra;
+            convolver->i_spectrum = 0;
+            __atomic_store_n (&convolver->spectra_next, NULL, __ATOMIC_RELAXED);
+        }
+
+        convolver->kernel_fading = convolver->kernel;
+        convolver->kernel = __atomic_exchange_n (&convolver->kernel_next, NULL, __ATOMIC_ACQUIRE);
+        convolver->i_fade = 0;
+    }
+}
+
+/* called once the window holds a full new partition of input,
+ * computes the tail of the next partition of output */
+static void convolver_process_partition (convolver_t *convolver) {
+
+    size_t n_bins = convolver->n_bins;
+    size_t n_points = convolver->fft.n_points;
+    sample_t *real = convolver->scratch_real;
+    sample_t *imaginary = convolver->scratch_imaginary;
+    sample_t *spectrum_real;
+    sample_t *spectrum_imaginary;
+
+    convolver_process_swap (convolver);
+    if (convolver->n_partitions < convolver->n_partitions_limit) {
+
+        convolver->n_partitions += CONVOLVER_N_PARTITIONS_GROW;
+        if (convolver->n_partitions > convolver->n_partitions_limit)
+            convolver->n_partitions = convolver->n_partitions_limit;
+    }
+
+    /* transform the window into the newest slot of the spectra */
+    convolver->i_spectrum = (convolver->i_spectrum + convolver->spectra->n - 1) % convolver->spectra->n;
+    memcpy (real, convolver->window, sizeof (sample_t) * n_points);
+    memset (imaginary, 0, sizeof (sample_t) * n_points);
+    fft_process (&convolver->fft, real, imaginary, false);
+    spectrum_real = convolver->spectra->real + convolver->i_spectrum * n_bins;
+    spectrum_imaginary = convolver->spectra->imaginary + convolver->i_spectrum * n_bins;
+    memcpy (spectrum_real, real, sizeof (sample_t) * n_bins);
+    memcpy (spectrum_imaginary, imaginary, sizeof (sample_t) * n_bins);
+
+    convolver_process_tail (convolver, convolver->kernel, convolver->tail);
+    if (convolver->kernel_fading)
+        convolver_process_tail (convolver, convolver->kernel_fading, convolver->tail_fading);
+
+    memmove (convolver->window,
+             convolver->window + CONVOLVER_PARTITION_SIZE,
+             sizeof (sample_t) * CONVOLVER_PARTITION_SIZE);
+    convolver->i_sample = 0;
+}
+
+/* input and output may be the same buffer */
+void convolver_process_block (convolver_t *convolver,
+                              const sample_t *input,
+                              sample_t *output,
+                              size_t n_samples) {
+
+    while (n_samples) {
+
+        size_t i;
+        size_t n = CONVOLVER_PARTITION_SIZE - convolver->i_sample;
+        const kernel_t *kernel = convolver->kernel;
+        const kernel_t *kernel_fading = convolver->kernel_fading;
+        if (n > n_samples)
+            n = n_samples;
+
+        for (i = 0; i < n; i++) {
+
+            size_t j;
+            size_t i_sample = convolver->i_sample + i;
+            sample_t *window = convolver->window + i_sample + 1;
+            sample_t sample = convolver->tail[i_sample];
+
+            convolver->window[CONVOLVER_PARTITION_SIZE + i_sample] = input[i];
+            if (kernel)
+                for (j = 0; j < CONVOLVER_PARTITION_SIZE; j++)
+                    sample += kernel->head[j] * window[j];
+
+            if (kernel_fading) {
+
+                sample_t faded = convolver->tail_fading[i_sample];
+                for (j = 0; j < CONVOLVER_PARTITION_SIZE; j++)
+                    faded += kernel_fading->head[j] * window[j];
+
+                sample = lerp ((double) convolver->i_fade / CONVOLVER_N_FADE, faded, sample);
+                if (convolver->i_fade < CONVOLVER_N_FADE)
+                    convolver->i_fade++;
+            }
+
+            output[i] = sample;
+        }
+
+        convolver->i_sample += n;
+        if (convolver->i_sample == CONVOLVER_PARTITION_SIZE)
+            convolver_process_partition (convolver);
+
+        input += n;
+        output += n;
+        n_samples -= n;
+    }
+}
+
+typedef struct bridge_t {
+
+    filter_t filter;
+    double coefficient_bypass;
+
+} bridge_t;
+
+void bridge_init (bridge_t *bridge, double coefficient_bypass) {
+
+    filter_init (&bridge->filter);
+    bridge->coefficient_bypass = coefficient_bypass;
+}
+
+void bridge_terminate (bridge_t *bridge) {
+
+    filter_terminate (&bridge->filter);
+}
+
+state_t bridge_process (bridge_t *bridge, state_t input) {
+
+    state_t bypass = bridge->coefficient_bypass * input;
+    return filter_process (&bridge->filter, input - bypass);
+}
+
+/* the instrument, with the defines of the same names in capitals for defaults;
+ * a patch file holds lines of a name and a value, # comments out the rest of
+ * a line, see patch_load; fixed for the life of a synth */
+typedef struct patch_t {
+
+    int voice_min;
+    int voice_max;
+    double sympathetic_resonance;               /* 0 leaves the strings uncoupled */
+    double coupling_admittance_min;
+    double coupling_admittance_max;
+    double coupling_harmonic;
+    double bend_range;
+    double time_glide;
+    double bridge_coefficient_bypass_min;
+    double bridge_coefficient_bypass_max;
+    double resonance_body;                      /* share of the body against the dry strings */
+    double cutoff_dc_blocker;
+    double cutoff_bridge_min;
+    double cutoff_bridge_max;
+    double cutoff_damper;
+    double cutoff_finger;
+    double coefficient_transition_finger_interpolation_exponent;
+    double coefficient_transition_finger_max;
+    double coefficient_transition_finger_min;
+    double coefficient_transition_finger_note_off;
+    double coefficient_transition_damper;
+    double hammer_strike_position_center;
+    double hammer_strike_position_variation;
+    double volume;
+    double output_pan_spread;
+
+} patch_t;
+
+typedef struct patch_field_t {
+
+    const char *name;
+    size_t offset;
+    bool integer;           /* an int rather than a double */
+    double min;             /* values past these are clamped to them */
+    double max;
+
+} patch_field_t;
+
+#define PATCH_FIELD(name, integer, min, max) { #name, offsetof (patch_t, name), integer, min, max }
+
+/* ranges keeping the filters and the glide finite and the strike on the
+ * string, see voice_pluck */
+static const patch_field_t patch_fields[] = {
+
+    PATCH_FIELD (voice_min, true, 0, N_VOICES - 1),
+    PATCH_FIELD (voice_max, true, 1, N_VOICES),
+    PATCH_FIELD (sympathetic_resonance, false, 0, 100),
+    PATCH_FIELD (coupling_admittance_min, false, 0, 100),
+    PATCH_FIELD (coupling_admittance_max, false, 0, 100),
+    PATCH_FIELD (coupling_harmonic, false, 0, 1),
+    PATCH_FIELD (bend_range, false, 0, 48),
+    PATCH_FIELD (time_glide, false, 0.0001, 10),
+    PATCH_FIELD (bridge_coefficient_bypass_min, false, 0, 1),
+    PATCH_FIELD (bridge_coefficient_bypass_max, false, 0, 1),
+    PATCH_FIELD (resonance_body, false, 0, 1),
+    PATCH_FIELD (cutoff_dc_blocker, false, 0.1, 100000),
+    PATCH_FIELD (cutoff_bridge_min, false, 0.1, 100000),
+    PATCH_FIELD (cutoff_bridge_max, false, 0.1, 100000),
+    PATCH_FIELD (cutoff_damper, false, 0.1, 100000),
+    PATCH_FIELD (cutoff_finger, false, 0.1, 100000),
+    PATCH_FIELD (coefficient_transition_finger_interpolation_exponent, false, 0, 100),
+    PATCH_FIELD (coefficient_transition_finger_max, false, 0.1, 1000000),
+    PATCH_FIELD (coefficient_transition_finger_min, false, 0.1, 1000000),
+    PATCH_FIELD (coefficient_transition_finger_note_off, false, 0.1, 1000000),
+    PATCH_FIELD (coefficient_transition_damper, false, 0.1, 1000000),
+    PATCH_FIELD (hammer_strike_position_center, false, 0, 0.99),
+    PATCH_FIELD (hammer_strike_position_variation, false, 0, 0.5),
+    PATCH_FIELD (volume, false, 0, 100),
+    PATCH_FIELD (output_pan_spread, false, 0, 1)
+};
+
+#define N_PATCH_FIELDS (sizeof (patch_fields) / sizeof (patch_fields[0]))
+
+void patch_init (patch_t *patch) {
+
+    patch->voice_min = VOICE_MIN;
+    patch->voice_max = VOICE_MAX;
+    patch->sympathetic_resonance = SYMPATHETIC_RESONANCE;
+    patch->coupling_admittance_min = COUPLING_ADMITTANCE_MIN;
+    patch->coupling_admittance_max = COUPLING_ADMITTANCE_MAX;
+    patch->coupling_harmonic = COUPLING_HARMONIC;
+    patch->bend_range = BEND_RANGE;
+    patch->time_glide = TIME_GLIDE;
+    patch->bridge_coefficient_bypass_min = BRIDGE_COEFFICIENT_BYPASS_MIN;
+    patch->bridge_coefficient_bypass_max = BRIDGE_COEFFICIENT_BYPASS_MAX;
+    patch->resonance_body = RESONANCE_BODY;
+    patch->cutoff_dc_blocker = CUTOFF_DC_BLOCKER;
+    patch->cutoff_bridge_min = CUTOFF_BRIDGE_MIN;
+    patch->cutoff_bridge_max = CUTOFF_BRIDGE_MAX;
+    patch->cutoff_damper = CUTOFF_DAMPER;
+    patch->cutoff_finger = CUTOFF_FINGER;
+    patch->coefficient_transition_finger_interpolation_exponent = COEFFICIENT_TRANSITION_FINGER_INTERPOLATION_EXPONENT;
+    patch->coefficient_transition_finger_max = COEFFICIENT_TRANSITION_FINGER_MAX;
+    patch->coefficient_transition_finger_min = COEFFICIENT_TRANSITION_FINGER_MIN;
+    patch->coefficient_transition_finger_note_off = COEFFICIENT_TRANSITION_FINGER_NOTE_OFF;
+    patch->coefficient_transition_damper = COEFFICIENT_TRANSITION_DAMPER;
+    patch->hammer_strike_position_center = HAMMER_STRIKE_POSITION_CENTER;
+    patch->hammer_strike_position_variation = HAMMER_STRIKE_POSITION_VARIATION;
+    patch->volume = VOLUME;
+    patch->output_pan_spread = OUTPUT_PAN_SPREAD;
+}
+
+/* the defaults with whatever path sets over them, a missing file leaving them
+ * be and returning false */
+bool patch_load (patch_t *patch, const char *path) {
+
+    FILE *file;
+    char line[256];
+    unsigned long i_line = 0;
+
+    patch_init (patch);
+    if (!(file = fopen (path, "r")))
+        return false;
+
+    while (fgets (line, sizeof (line), file)) {
+
+        char name[64];
+        char *comment = strchr (line, '#');
+        double value;
+        size_t i;
+
+        i_line++;
+        if (comment)
+            *comment = 0;
+        if (sscanf (line, "%63s", name) < 1)
+            continue;
+
+        for (i = 0; i < N_PATCH_FIELDS && strcmp (name, patch_fields[i].name); i++)
+            ;
+
+        if (i == N_PATCH_FIELDS || sscanf (line, "%*s %lf", &value) < 1 || value != value) {
+
+            fprintf (stderr, "dunno wat line %lu of %s means... 😭\n", i_line, path);
+            continue;
+        }
+
+        /* before it goes anywhere near an int */
+        if (value < patch_fields[i].min || value > patch_fields[i].max) {
+
+            value = value < patch_fields[i].min ? patch_fields[i].min : patch_fields[i].max;
+            fprintf (stderr, "%s on line %lu of %s is out of range, taking %g... 😭\n", name, i_line, path, value);
+        }
+
+        if (patch_fields[i].integer)
+            *(int *) ((char *) patch + patch_fields[i].offset) = value;
+        else
+            *(double *) ((char *) patch + patch_fields[i].offset) = value;
+    }
+
+    fclose (file);
+
+    if (patch->voice_min < 0 || patch->voice_max > N_VOICES || patch->voice_min >= patch->voice_max) {
+
+        fprintf (stderr, "da strings of %s r out of range, playing %d to %d... 😭\n", path, VOICE_MIN, VOICE_MAX - 1);
+        patch->voice_min = VOICE_MIN;
+        patch->voice_max = VOICE_MAX;
+    }
+
+    if (patch->hammer_strike_position_center - patch->hammer_strike_position_variation < 0
+        || patch->hammer_strike_position_center + patch->hammer_strike_position_variation >= 1) {
+
+        fprintf (stderr, "da strike of %s comes off da string, striking at %g... 😭\n",
+                 path, patch->hammer_strike_position_center);
+        patch->hammer_strike_position_variation = 0;
+    }
+
+    return true;
+}
+
+/* whether two patches play the same, field by field */
+bool patch_equal (const patch_t *patch, const patch_t *other) {
+
+    size_t i;
+
+    for (i = 0; i < N_PATCH_FIELDS; i++) {
+
+        const char *field = (const char *) patch + patch_fields[i].offset;
+        const char *field_other = (const char *) other + patch_fields[i].offset;
+
+        if (patch_fields[i].integer
+            ? *(const int *) field != *(const int *) field_other
+            : *(const double *) field != *(const double *) field_other)
+            return false;
+    }
+
+    return true;
+}
+
+/* every filter coefficient the strings can ask for at one rate,
+ * so that notes and controllers never reach for exp () */
+typedef struct coefficients_t {
+
+    double rate;
+    state_t dc_blocker;
+    state_t damper;
+    state_t finger;
+    state_t transition_damper;
+    state_t transition_finger_note_off;
+    state_t bridge[N_VOICES];               /* by note */
+    state_t transition_finger[128];         /* by midi velocity */
+
+} coefficients_t;
+
+void coefficients_init (coefficients_t *coefficients, const patch_t *patch, double rate) {
+
+    size_t i;
+
+    coefficients->rate = rate;
+    coefficients->dc_blocker = filter_coefficient (patch->cutoff_dc_blocker, rate);
+    coefficients->damper = filter_coefficient (patch->cutoff_damper, rate);
+    coefficients->finger = filter_coefficient (patch->cutoff_finger, rate);
+    coefficients->transition_damper = filter_coefficient (patch->coefficient_transition_damper, rate);
+    coefficients->transition_finger_note_off = filter_coefficient (patch->coefficient_transition_finger_note_off, rate);
+
+    for (i = 0; i < N_VOICES; i++)
+        coefficients->bridge[i] = filter_coefficient (interpolate_exponential (i / 127.0,
+                                                                               2,
+                                                                               patch->cutoff_bridge_min,
+                                                                               patch->cutoff_bridge_max),
+                                                      rate);
+
+    for (i = 0; i < 128; i++)
+        coefficients->transition_finger[i]
+            = filter_coefficient (interpolate_exponential (i / 127.0,
+                                                           patch->coefficient_transition_finger_interpolation_exponent,
+                                                           patch->coefficient_transition_finger_min,
+                                                           patch->coefficient_transition_finger_max),
+                                  rate);
+}
+
+/* velocities between midi ones are interpolated */
+state_t coefficients_transition_finger (const coefficients_t *coefficients, double velocity) {
+
+    size_t i;
+
+    if (velocity <= 0)
+        return coefficients->transition_finger[0];
+    if (velocity >= 127)
+        return coefficients->transition_finger[127];
+
+    i = velocity;
+    return lerp (velocity - i, coefficients->transition_finger[i], coefficients->transition_finger[i + 1]);
+}
+
+typedef struct voice_t {
+
+    delay_t delay;
+    double length;                  /* of the loop in samples, whole ones in the delay line */
+    double length_target;
+    state_t interpolation[DELAY_INTERPOLATION_ORDER + 1];
+    filter_t filter_dc_blocker;
+    filter_t filter_damper;
+    filter_t filter_finger;
+    filter_t filter_transition_damper;
+    filter_t filter_transition_finger;
+    bridge_t bridge_input;
+    bridge_t bridge_output;
+    const coefficients_t *coefficients;
+    const patch_t *patch;
+    int note;
+    double frequency;
+    double admittance;              /* to the bridge, for the sympathetic coupling */
+    double pan_left;
+    double pan_right;
+    size_t stem;
+    double target_coefficient_damper;
+    double target_coefficient_finger;
+    double velocity;                /* of the last note on */
+    bool released;
+    double sustain;
+    double bend;                    /* frequency ratio */
+
+    /* pluck being laid into the line ahead of the reads */
+    const buffer_t *pluck;          /* for the next note on, NULL for the bare shape, see voice_pluck_set */
+    const sample_t *excitation;     /* of the one under way, NULL for the bare shape */
+    double velocity_excitation;
+    double position_excitation;     /* of the hammer strike along the string */
+    size_t i_excitation;
+    size_t n_excitation;
+    uint32_t random;
+
+    /* activity tracking */
+    bool active;
+    double peak;            /* loudest sample written during the current period */
+    double peak_period;     /* loudest sample written during the last full period */
+    size_t i_period;        /* samples written into the current period */
+
+    double rate;
+
+} voice_t;
+
+/* pans the string by where it sits among the playable ones, with the nearer
+ * side kept whole so that a centred string stays as loud as a mono one,
+ * and picks the stem it goes out through */
+static void voice_position_set (voice_t *voice, int note, int voice_min, int voice_max) {
+
+    double position = voice_max - 1 > voice_min ? (note - voice_min) / (double) (voice_max - 1 - voice_min) : 0.5;
+    double pan;
+
+    /* strings out of range are never played */
+    if (note < voice_min || note >= voice_max) {
+
+        voice->pan_left = voice->pan_right = 1;
+        voice->stem = 0;
+        return;
+    }
+
+    pan = voice->patch->output_pan_spread * (2 * position - 1);
+    voice->pan_left = pan > 0 ? 1 - pan : 1;
+    voice->pan_right = pan < 0 ? 1 + pan : 1;
+    voice->stem = (note - voice_min) * OUTPUT_N_STEMS / (voice_max - voice_min);
+}
+
+/* each voice draws its own noise, seeded off the audio thread */
+void voice_seed (voice_t *voice, uint32_t seed) {
+
+    /* xorshift never leaves zero */
+    voice->random = seed * 2 + 1;
+}
+
+/* patch has to outlive the voice */
+void voice_init (voice_t *voice, int note, const patch_t *patch) {
+
+    double bypass;
+    memset (voice, 0, sizeof (voice_t));
+    voice->patch = patch;
+    voice->note = note;
+    voice->frequency = 440 * pow (2, (note - 69) / 12.0);
+    voice->admittance = lerp (note / 127.0, patch->coupling_admittance_min, patch->coupling_admittance_max);
+    voice_position_set (voice, note, patch->voice_min, patch->voice_max);
+    bypass = interpolate_exponential (note / 127.0,
+                                      2,
+                                      patch->bridge_coefficient_bypass_min,
+                                      patch->bridge_coefficient_bypass_max);
+    filter_init (&voice->filter_dc_blocker);
+    filter_init (&voice->filter_damper);
+    filter_init (&voice->filter_finger);
+    filter_init (&voice->filter_transition_damper);
+    filter_init (&voice->filter_transition_finger);
+    bridge_init (&voice->bridge_input, bypass);
+    bridge_init (&voice->bridge_output, bypass);
+    voice->target_coefficient_damper = 0;
+    voice->target_coefficient_finger = 0;
+    voice->velocity = 127;
+    voice->sustain = 1;
+    voice->bend = 1;
+    voice_seed (voice, note);
+}
+
+void voice_terminate (voice_t *voice) {
+
+    delay_terminate (&voice->delay);
+    filter_terminate (&voice->filter_dc_blocker);
+    filter_terminate (&voice->filter_damper);
+    filter_terminate (&voice->filter_finger);
+    filter_terminate (&voice->filter_transition_damper);
+    filter_terminate (&voice->filter_transition_finger);
+    bridge_terminate (&voice->bridge_input);
+    bridge_terminate (&voice->bridge_output);
+}
+
+static void voice_length_set (voice_t *voice, double length) {
+
+    voice->length = length;
+    delay_length_set (&voice->delay, delay_length_whole (length));
+    delay_interpolation_set (voice->interpolation, length - voice->delay.n_samples);
+}
+
+void voice_update (voice_t *voice) {
+
+    const coefficients_t *coefficients = voice->coefficients;
+
+    voice->length_target = voice->rate / (voice->frequency * voice->bend);
+    voice->filter_dc_blocker.coefficient = coefficients->dc_blocker;
+    voice->filter_damper.coefficient = coefficients->damper;
+    voice->filter_finger.coefficient = coefficients->finger;
+    voice->filter_transition_damper.coefficient = coefficients->transition_damper;
+    voice->filter_transition_finger.coefficient
+        = voice->released ? coefficients->transition_finger_note_off
+                          : coefficients_transition_finger (coefficients, voice->velocity);
+    voice->bridge_input.filter.coefficient = coefficients->bridge[voice->note];
+    voice->bridge_output.filter.coefficient = coefficients->bridge[voice->note];
+}
+
+/* the delay line needed at rate for the lowest reachable pitch; the interpolator
+ * reads DELAY_INTERPOLATION_ORDER samples further back, and the oldest of them
+ * must outlive the write of the current sample */
+size_t voice_n_samples_max (voice_t *voice, double rate) {
+
+    double length_max = rate / (voice->frequency * pow (2, -voice->patch->bend_range / 12.0));
+    return delay_length_whole (length_max) + DELAY_INTERPOLATION_ORDER + 1;
+}
+
+/* the string runs in n_samples of buffer, cleared beforehand,
+ * until it is given another; without one it must never be played */
+void voice_buffer_set (voice_t *voice, sample_t *buffer, size_t n_samples) {
+
+    delay_init (&voice->delay, n_samples, buffer);
+    voice_length_set (voice, voice->length_target);
+}
+
+/* the coefficients are shared and must outlive the voice */
+void voice_rate_set (voice_t *voice, const coefficients_t *coefficients) {
+
+    voice->coefficients = coefficients;
+    voice->rate = coefficients->rate;
+    voice_update (voice);
+    voice_length_set (voice, voice->length_target);
+}
+
+/* retunes by a frequency ratio, reached gradually through voice_glide */
+void voice_bend_set (voice_t *voice, double bend) {
+
+    voice->bend = bend;
+    voice->length_target = voice->rate / (voice->frequency * bend);
+}
+
+/* moves the length share of the way to its target, once per block */
+void voice_glide (voice_t *voice, double share) {
+
+    double length = voice->length + share * (voice->length_target - voice->length);
+
+    if (voice->length == voice->length_target)
+        return;
+    if (fabs (voice->length_target - length) < 1e-6)
+        length = voice->length_target;
+    voice_length_set (voice, length);
+}
+
+/* voice_process_block, inlined into a copy for each value of bypassed so that
+ * strings passing their whole termination to the bridge filter skip the scaling */
+static __inline__ __attribute__ ((always_inline))
+void voice_process_kernel (voice_t *voice, sample_t *output, size_t n_samples, bool bypassed) {
+
+    state_t state_transition_damper = voice->filter_transition_damper.state;
+    state_t state_transition_finger = voice->filter_transition_finger.state;
+    state_t state_dc_blocker = voice->filter_dc_blocker.state;
+    state_t state_damper = voice->filter_damper.state;
+    state_t state_finger = voice->filter_finger.state;
+    state_t state_bridge_output = voice->bridge_output.filter.state;
+
+    state_t k_transition_damper = voice->filter_transition_damper.coefficient;
+    state_t k_transition_finger = voice->filter_transition_finger.coefficient;
+    state_t k_dc_blocker = voice->filter_dc_blocker.coefficient;
+    state_t k_damper = voice->filter_damper.coefficient;
+    state_t k_finger = voice->filter_finger.coefficient;
+    state_t k_bridge_output = voice->bridge_output.filter.coefficient;
+    state_t pass_bridge_output = 1 - voice->bridge_output.coefficient_bypass;
+
+    state_t target_coefficient_damper = voice->target_coefficient_damper;
+    state_t target_coefficient_finger = voice->sustain * voice->target_coefficient_finger;
+
+    sample_t *pointer = voice->delay.buffer_pointer;
+    sample_t *tap = delay_tap (&voice->delay, 0);
+    sample_t taps[DELAY_INTERPOLATION_ORDER + 1];
+    state_t interpolation[DELAY_INTERPOLATION_ORDER + 1];
+    size_t k;
+
+    memcpy (interpolation, voice->interpolation, sizeof (interpolation));
+
+    /* the taps read before this block, from the buffer since
+     * the length may have changed in between */
+    for (k = 0; k < DELAY_INTERPOLATION_ORDER; k++)
+        taps[k] = *delay_tap (&voice->delay, -1 - (long) k);
+
+    while (n_samples) {
+
+        size_t i;
+        size_t n = voice->delay.buffer_tail - pointer;
+        if (n > (size_t) (voice->delay.buffer_tail - tap))
+            n = voice->delay.buffer_tail - tap;
+        if (n > n_samples)
+            n = n_samples;
+
+        for (i = 0; i < n; i++) {
+
+            state_t delay = 0;
+            state_t dc_blocker;
+            state_t damper_damped;
+            state_t pre_termination;
+            state_t finger_damped;
+            state_t termination;
+            state_t reflection_bridge_output;
+
+            /* transitions */
+            state_transition_damper += k_transition_damper * (target_coefficient_damper - state_transition_damper);
+            state_transition_finger += k_transition_finger * (target_coefficient_finger - state_transition_finger);
+
+            /* fractional delay */
+            for (k = DELAY_INTERPOLATION_ORDER; k; k--)
+                taps[k] = taps[k - 1];
+            taps[0] = tap[i];
+            for (k = 0; k <= DELAY_INTERPOLATION_ORDER; k++)
+                delay += interpolation[k] * taps[k];
+
+            /* dc blocker */
+            state_dc_blocker += k_dc_blocker * (delay - state_dc_blocker);
+            dc_blocker = delay - state_dc_blocker;
+
+            /* damper */
+            damper_damped = state_transition_damper * dc_blocker;
+            state_damper += k_damper * (damper_damped - state_damper);
+            pre_termination = state_damper + dc_blocker - damper_damped;
+
+            /* finger */
+            finger_damped = state_transition_finger * pre_termination;
+            state_finger += k_finger * (finger_damped - state_finger);
+            termination = state_finger + pre_termination - finger_damped;
+
+            /* termination */
+            state_bridge_output += k_bridge_output * ((bypassed ? pass_bridge_output * termination : termination)
+                                                      - state_bridge_output);
+            reflection_bridge_output = state_bridge_output;
+            output[i] = termination - reflection_bridge_output;
+            pointer[i] = reflection_bridge_output;
+        }
+
+        pointer += n;
+        if (pointer >= voice->delay.buffer_tail)
+            pointer = voice->delay.buffer_head;
+        tap += n;
+        if (tap >= voice->delay.buffer_tail)
+            tap = voice->delay.buffer_head;
+        output += n;
+        n_samples -= n;
+    }
+
+    voice->delay.buffer_pointer = pointer;
+
+    voice->filter_transition_damper.state = state_transition_damper;
+    voice->filter_transition_finger.state = state_transition_finger;
+    voice->filter_dc_blocker.state = state_dc_blocker;
+    voice->filter_damper.state = state_damper;
+    voice->filter_finger.state = state_finger;
+    voice->bridge_output.filter.state = state_bridge_output;
+}
+
+/* runs the string for n_samples, which must not exceed the delay length,
+ * writing its reflections into the delay line; the input coming from the
+ * bridge is added to the same samples afterwards with voice_input_block */
+void voice_process_block (voice_t *voice, sample_t *output, size_t n_samples) {
+
+    if (voice->bridge_output.coefficient_bypass)
+        voice_process_kernel (voice, output, n_samples, true);
+    else
+        voice_process_kernel (voice, output, n_samples, false);
+}
+
+/* voice_input_block, inlined into a copy for each case: without coupling
+ * only the activity is followed, and a string hearing the whole input
+ * skips the scaling */
+static __inline__ __attribute__ ((always_inline))
+void voice_input_kernel (voice_t *voice, const sample_t *input, size_t n_samples, bool coupled, bool scaled) {
+
+    state_t state_bridge_input = voice->bridge_input.filter.state;
+    state_t k_bridge_input = voice->bridge_input.filter.coefficient;
+    state_t pass_bridge_input = voice->admittance * (1 - voice->bridge_input.coefficient_bypass);
+    double peak = voice->peak;
+    size_t i_period = voice->i_period;
+
+    sample_t *pointer = voice->delay.buffer_pointer - n_samples;
+    if (pointer < voice->delay.buffer_head)
+        pointer += voice->delay.buffer_tail - voice->delay.buffer_head;
+
+    while (n_samples) {
+
+        size_t i;
+        size_t n = voice->delay.buffer_tail - pointer;
+        if (n > n_samples)
+            n = n_samples;
+
+        for (i = 0; i < n; i++) {
+
+            double delay = pointer[i];
+
+            if (coupled) {
+
+                state_bridge_input += k_bridge_input * ((scaled ? pass_bridge_input * input[i] : input[i])
+                                                        - state_bridge_input);
+                delay = pointer[i] += state_bridge_input;
+            }
+
+            /* activity */
+            delay = fabs (delay);
+            if (delay > peak)
+                peak = delay;
+            if (++i_period >= voice->delay.n_samples) {
+
+                voice->peak_period = peak;
+                peak = 0;
+                i_period = 0;
+            }
+        }
+
+        pointer += n;
+        if (pointer >= voice->delay.buffer_tail)
+            pointer = voice->delay.buffer_head;
+        if (coupled)
+            input += n;
+        n_samples -= n;
+    }
+
+    voice->bridge_input.filter.state = state_bridge_input;
+    voice->peak = peak;
+    voice->i_period = i_period;
+}
+
+/* adds the transmission of input through the bridge to the n_samples last
+ * written by voice_process_block, NULL for none without coupling */
+void voice_input_block (voice_t *voice, const sample_t *input, size_t n_samples) {
+
+    if (!input)
+        voice_input_kernel (voice, NULL, n_samples, false, false);
+    else if (voice->admittance * (1 - voice->bridge_input.coefficient_bypass) != 1)
+        voice_input_kernel (voice, input, n_samples, true, true);
+    else
+        voice_input_kernel (voice, input, n_samples, true, false);
+}
+
+/* level is what the string is taken to sound at until it has run a full period,
+ * 1 for a note on, what it heard for one woken by the others */
+void voice_activate (voice_t *voice, double level) {
+
+    /* a silent string can take up a bend right away */
+    if (!voice->active)
+        voice_length_set (voice, voice->length_target);
+
+    /* stay around for at least one full period */
+    voice->active = true;
+    voice->peak = voice->peak_period = level;
+}
+
+bool voice_idle (voice_t *voice, double floor) {
+
+    return voice->peak_period < floor
+        && voice->peak < floor
+        && fabs (voice->filter_dc_blocker.state) < floor
+        && fabs (voice->filter_damper.state) < floor
+        && fabs (voice->filter_finger.state) < floor
+        && fabs (voice->bridge_input.filter.state) < floor
+        && fabs (voice->bridge_output.filter.state) < floor;
+}
+
+void voice_deactivate (voice_t *voice) {
+
+    /* settle the transitions where they were heading */
+    voice->active = false;
+    voice->filter_transition_damper.state = voice->target_coefficient_damper;
+    voice->filter_transition_finger.state = voice->sustain * voice->target_coefficient_finger;
+}
+
+/* the pluck is only laid into the line a block at a time by voice_excite_block,
+ * so a note on costs the same however long the string;
+ * a new one takes over from whatever is left of the last */
+static void voice_excite (voice_t *voice, double velocity) {
+
+    voice->velocity_excitation = velocity;
+    voice->position_excitation = voice->patch->hammer_strike_position_center
+                               + voice->patch->hammer_strike_position_variation
+                               * (noise_next (&voice->random) * 2 - 1);
+    voice->i_excitation = 0;
+    voice->n_excitation = voice->delay.n_samples;
+    voice->excitation = NULL;
+
+    if (voice->pluck && voice->pluck->n_samples) {
+
+        voice->n_excitation = voice->pluck->n_samples;
+        voice->excitation = voice->pluck->data;
+    }
+}
+
+/* the bare pluck at position from 0 to 2 over a period, struck at strike */
+static double voice_pluck (double position, double strike) {
+
+    double sign = 1;
+
+    if (position > 1) {
+
+        position = 2 - position;
+        sign = -1;
+    }
+
+    if (position < strike)
+        return sign * (position / strike);
+    else
+        return sign * (1 - (position - strike) / (1 - strike));
+}
+
+/* adds the next n_samples of a pluck under way to the samples from tap on,
+ * in a ring from head to tail */
+static void voice_excite_ring (voice_t *voice, sample_t *tap, sample_t *head, sample_t *tail, size_t n_samples) {
+
+    double velocity = voice->velocity_excitation;
+    double hammer_strike_position = voice->position_excitation;
+    size_t i;
+
+    if (n_samples > voice->n_excitation - voice->i_excitation)
+        n_samples = voice->n_excitation - voice->i_excitation;
+    if (!n_samples)
+        return;
+
+    if (voice->excitation) {
+
+        const sample_t *excitation = voice->excitation + voice->i_excitation;
+
+        for (i = 0; i < n_samples; i++) {
+
+            *tap += velocity * excitation[i];
+            if (++tap == tail)
+                tap = head;
+        }
+
+        voice->i_excitation += n_samples;
+        return;
+    }
+
+    for (i = 0; i < n_samples; i++) {
+
+        double position = (voice->i_excitation + i) / (double) voice->n_excitation * 2;
+        double sample = velocity * voice_pluck (position, hammer_strike_position);
+
+        *tap += sample / 2;
+        if (++tap == tail)
+            tap = head;
+    }
+
+    voice->i_excitation += n_samples;
+}
+
+/* adds the next n_samples of a pluck under way to the samples about to be read,
+ * to be called before the string is run for a block of n_samples */
+void voice_excite_block (voice_t *voice, size_t n_samples) {
+
+    voice_excite_ring (voice, delay_tap (&voice->delay, 0), voice->delay.buffer_head, voice->delay.buffer_tail, n_samples);
+}
+
+/* the same into n_samples of excitation, which it leaves silent without one,
+ * for strings run without their line */
+void voice_excite_buffer (voice_t *voice, sample_t *excitation, size_t n_samples) {
+
+    memset (excitation, 0, sizeof (sample_t) * n_samples);
+    voice_excite_ring (voice, excitation, excitation, excitation + n_samples, n_samples);
+}
+
+void voice_note_on (voice_t *voice, double velocity) {
+
+    double velocity_normalized = velocity / 127.0;
+    voice->target_coefficient_finger = 0;
+    voice->filter_transition_finger.state = 1;
+    voice_excite (voice, velocity_normalized);
+    voice->velocity = velocity;
+    voice->released = false;
+    voice->filter_transition_finger.coefficient = coefficients_transition_finger (voice->coefficients, velocity);
+}
+
+/* the next note on lays pluck into the line instead of the bare shape, scaled
+ * by velocity, for as long as it lasts; it must outlive the note, NULL for
+ * the bare shape again */
+void voice_pluck_set (voice_t *voice, const buffer_t *pluck) {
+
+    voice->pluck = pluck;
+}
+
+void voice_note_off (voice_t *voice, double velocity) {
+
+    voice->target_coefficient_finger = 1;
+    voice->released = true;
+    voice->filter_transition_finger.coefficient = voice->coefficients->transition_finger_note_off;
+}
+
+void voice_damper_set (voice_t *voice, double damper) {
+
+    voice->target_coefficient_damper = damper;
+}
+
+void voice_sustain_set (voice_t *voice, double sustain) {
+
+    voice->sustain = sustain;
+}
+
+/* mixes output, as written by voice_process_block, into busses
+ * the way voice_bank_process_block does for a whole bank */
+void voice_mix_block (voice_t *voice,
+                      const sample_t *output,
+                      sample_t (*busses)[N_FRAMES_BLOCK],
+                      size_t n_sends,
+                      size_t n_samples) {
+
+    size_t i;
+    sample_t *left = busses[BUS_LEFT];
+    sample_t *right = busses[BUS_RIGHT];
+    sample_t *bridge = busses[BUS_SEND];
+    state_t pan_left = voice->pan_left;
+    state_t pan_right = voice->pan_right;
+    state_t admittance = voice->admittance;
+
+    for (i = 0; i < n_samples; i++) {
+
+        left[i] += pan_left * output[i];
+        right[i] += pan_right * output[i];
+    }
+
+    if (n_sends)
+        for (i = 0; i < n_samples; i++)
+            bridge[i] += admittance * output[i];
+
+    if (OUTPUT_N_STEMS) {
+
+        sample_t *stem = busses[BUS_STEM + voice->stem];
+        for (i = 0; i < n_samples; i++)
+            stem[i] += output[i];
+    }
+
+    if (n_sends > 1) {
+
+        sample_t *send = busses[BUS_SEND + 1 + voice->note % N_PITCH_CLASSES];
+        for (i = 0; i < n_samples; i++)
+            send[i] += admittance * output[i];
+    }
+}
+
+/* one string per lane, no alignment beyond the scalar one is assumed */
+typedef state_t lane_t __attribute__ ((vector_size (SIZE_VECTOR), aligned (sizeof (state_t))));
+
+/* structure of arrays copy of the dsp state of a set of voices,
+ * so that N_LANES strings advance per instruction; loaded from and stored
+ * back to the voices around every block, unused lanes run a silent dummy */
+typedef struct voice_bank_t {
+
+    size_t n_voices;
+    size_t n_groups;
+    voice_t *voices[N_LANE_GROUPS * N_LANES];
+    sample_t *pointers[N_LANE_GROUPS * N_LANES];
+    sample_t *reads[N_LANE_GROUPS * N_LANES];         /* oldest interpolator tap */
+    sample_t *heads[N_LANE_GROUPS * N_LANES];
+    sample_t *tails[N_LANE_GROUPS * N_LANES];
+    double peaks[N_LANE_GROUPS * N_LANES];
+    double peaks_period[N_LANE_GROUPS * N_LANES];
+    size_t i_periods[N_LANE_GROUPS * N_LANES];
+    size_t n_periods[N_LANE_GROUPS * N_LANES];
+    size_t pitch_classes[N_LANE_GROUPS * N_LANES];
+    size_t stems[N_LANE_GROUPS * N_LANES];
+    bool bypassed;                  /* some string passes only part of its termination to the bridge filter */
+    bool scaled;                    /* some string hears only part of the input */
+
+    lane_t state_transition_damper[N_LANE_GROUPS];
+    lane_t state_transition_finger[N_LANE_GROUPS];
+    lane_t state_dc_blocker[N_LANE_GROUPS];
+    lane_t state_damper[N_LANE_GROUPS];
+    lane_t state_finger[N_LANE_GROUPS];
+    lane_t state_bridge_output[N_LANE_GROUPS];
+    lane_t state_bridge_input[N_LANE_GROUPS];
+
+    lane_t k_transition_damper[N_LANE_GROUPS];
+    lane_t k_transition_finger[N_LANE_GROUPS];
+    lane_t k_dc_blocker[N_LANE_GROUPS];
+    lane_t k_damper[N_LANE_GROUPS];
+    lane_t k_finger[N_LANE_GROUPS];
+    lane_t k_bridge_output[N_LANE_GROUPS];
+    lane_t k_bridge_input[N_LANE_GROUPS];
+    lane_t pass_bridge_output[N_LANE_GROUPS];
+    lane_t pass_bridge_input[N_LANE_GROUPS];
+    lane_t target_coefficient_damper[N_LANE_GROUPS];
+    lane_t target_coefficient_finger[N_LANE_GROUPS];
+    lane_t admittance[N_LANE_GROUPS];
+    lane_t pan_left[N_LANE_GROUPS];
+    lane_t pan_right[N_LANE_GROUPS];
+    lane_t interpolation[N_LANE_GROUPS][DELAY_INTERPOLATION_ORDER + 1];
+
+    lane_t taps[N_FRAMES_BLOCK + DELAY_INTERPOLATION_ORDER];
+    lane_t output[N_FRAMES_BLOCK];              /* of one group */
+    lane_t left[N_FRAMES_BLOCK];                /* of every group, lanes summed last */
+    lane_t right[N_FRAMES_BLOCK];
+    lane_t send[N_FRAMES_BLOCK];
+    sample_t dummy;
+
+} voice_bank_t;
+
+void voice_bank_load (voice_bank_t *bank, voice_t *voices, size_t *i_voices, size_t n_voices) {
+
+    size_t i;
+
+    bank->n_voices = n_voices;
+    bank->n_groups = (n_voices + N_LANES - 1) / N_LANES;
+    bank->bypassed = bank->scaled = false;
+
+    for (i = 0; i < bank->n_groups * N_LANES; i++) {
+
+        size_t g = i / N_LANES;
+        size_t l = i % N_LANES;
+        size_t j;
+        voice_t *voice = i < n_voices ? &voices[i_voices[i]] : NULL;
+
+        bank->voices[i] = voice;
+
+        if (!voice) {
+
+            bank->dummy = 0;
+            bank->pointers[i] = bank->reads[i] = bank->heads[i] = &bank->dummy;
+            bank->tails[i] = &bank->dummy + 1;
+            bank->i_periods[i] = 0;
+            bank->n_periods[i] = 1;
+            bank->pitch_classes[i] = 0;
+            bank->stems[i] = 0;
+            for (j = 0; j <= DELAY_INTERPOLATION_ORDER; j++)
+                bank->interpolation[g][j][l] = 0;
+            bank->state_transition_damper[g][l] = 0;
+            bank->state_transition_finger[g][l] = 0;
+            bank->state_dc_blocker[g][l] = 0;
+            bank->state_damper[g][l] = 0;
+            bank->state_finger[g][l] = 0;
+            bank->state_bridge_output[g][l] = 0;
+            bank->state_bridge_input[g][l] = 0;
+            bank->k_transition_damper[g][l] = 0;
+            bank->k_transition_finger[g][l] = 0;
+            bank->k_dc_blocker[g][l] = 0;
+            bank->k_damper[g][l] = 0;
+            bank->k_finger[g][l] = 0;
+            bank->k_bridge_output[g][l] = 0;
+            bank->k_bridge_input[g][l] = 0;
+            bank->pass_bridge_output[g][l] = 0;
+            bank->pass_bridge_input[g][l] = 0;
+            bank->target_coefficient_damper[g][l] = 0;
+            bank->target_coefficient_finger[g][l] = 0;
+            bank->admittance[g][l] = 0;
+            bank->pan_left[g][l] = 0;
+            bank->pan_right[g][l] = 0;
+            continue;
+        }
+
+        bank->pointers[i] = voice->delay.buffer_pointer;
+        bank->reads[i] = delay_tap (&voice->delay, -DELAY_INTERPOLATION_ORDER);
+        bank->heads[i] = voice->delay.buffer_head;
+        bank->tails[i] = voice->delay.buffer_tail;
+        bank->peaks[i] = voice->peak;
+        bank->peaks_period[i] = voice->peak_period;
+        bank->i_periods[i] = voice->i_period;
+        bank->n_periods[i] = voice->delay.n_samples;
+        bank->pitch_classes[i] = voice->note % N_PITCH_CLASSES;
+        bank->stems[i] = voice->stem;
+        for (j = 0; j <= DELAY_INTERPOLATION_ORDER; j++)
+            bank->interpolation[g][j][l] = voice->interpolation[j];
+        bank->state_transition_damper[g][l] = voice->filter_transition_damper.state;
+        bank->state_transition_finger[g][l] = voice->filter_transition_finger.state;
+        bank->state_dc_blocker[g][l] = voice->filter_dc_blocker.state;
+        bank->state_damper[g][l] = voice->filter_damper.state;
+        bank->state_finger[g][l] = voice->filter_finger.state;
+        bank->state_bridge_output[g][l] = voice->bridge_output.filter.state;
+        bank->state_bridge_input[g][l] = voice->bridge_input.filter.state;
+        bank->k_transition_damper[g][l] = voice->filter_transition_damper.coefficient;
+        bank->k_transition_finger[g][l] = voice->filter_transition_finger.coefficient;
+        bank->k_dc_blocker[g][l] = voice->filter_dc_blocker.coefficient;
+        bank->k_damper[g][l] = voice->filter_damper.coefficient;
+        bank->k_finger[g][l] = voice->filter_finger.coefficient;
+        bank->k_bridge_output[g][l] = voice->bridge_output.filter.coefficient;
+        bank->k_bridge_input[g][l] = voice->bridge_input.filter.coefficient;
+        bank->pass_bridge_output[g][l] = 1 - voice->bridge_output.coefficient_bypass;
+        bank->pass_bridge_input[g][l] = voice->admittance * (1 - voice->bridge_input.coefficient_bypass);
+        bank->target_coefficient_damper[g][l] = voice->target_coefficient_damper;
+        bank->target_coefficient_finger[g][l] = voice->sustain * voice->target_coefficient_finger;
+        bank->admittance[g][l] = voice->admittance;
+        bank->pan_left[g][l] = voice->pan_left;
+        bank->pan_right[g][l] = voice->pan_right;
+        bank->bypassed |= bank->pass_bridge_output[g][l] != 1;
+        bank->scaled |= bank->pass_bridge_input[g][l] != 1;
+    }
+}
+
+void voice_bank_store (voice_bank_t *bank) {
+
+    size_t i;
+
+    for (i = 0; i < bank->n_voices; i++) {
+
+        size_t g = i / N_LANES;
+        size_t l = i % N_LANES;
+        voice_t *voice = bank->voices[i];
+
+        voice->delay.buffer_pointer = bank->pointers[i];
+        voice->peak = bank->peaks[i];
+        voice->peak_period = bank->peaks_period[i];
+        voice->i_period = bank->i_periods[i];
+        voice->filter_transition_damper.state = bank->state_transition_damper[g][l];
+        voice->filter_transition_finger.state = bank->state_transition_finger[g][l];
+        voice->filter_dc_blocker.state = bank->state_dc_blocker[g][l];
+        voice->filter_damper.state = bank->state_damper[g][l];
+        voice->filter_finger.state = bank->state_finger[g][l];
+        voice->bridge_output.filter.state = bank->state_bridge_output[g][l];
+        voice->bridge_input.filter.state = bank->state_bridge_input[g][l];
+    }
+}
+
+/* the n_samples of a delay line starting at pointer, wrapping at tail,
+ * to or from lane l of lanes */
+static void voice_bank_gather (lane_t *lanes, size_t l,
+                               sample_t *pointer, sample_t *head, sample_t *tail,
+                               size_t n_samples) {
+
+    size_t i;
+
+    for (i = 0; i < n_samples; i++) {
+
+        lanes[i][l] = *pointer;
+        if (++pointer >= tail)
+            pointer = head;
+    }
+}
+
+static void voice_bank_scatter (lane_t *lanes, size_t l,
+                                sample_t *pointer, sample_t *head, sample_t *tail,
+                                size_t n_samples) {
+
+    size_t i;
+
+    for (i = 0; i < n_samples; i++) {
+
+        *pointer = lanes[i][l];
+        if (++pointer >= tail)
+            pointer = head;
+    }
+}
+
+static sample_t *voice_bank_advance (sample_t *pointer, sample_t *head, sample_t *tail, size_t n_samples) {
+
+    pointer += n_samples % (tail - head);
+    if (pointer >= tail)
+        pointer -= tail - head;
+    return pointer;
+}
+
+/* one group of voice_bank_process_block, inlined into a copy for each
+ * combination of the flags so that strings passing their whole termination
+ * to the bridge filter skip the scaling, and uncoupled ones the send */
+static __inline__ __attribute__ ((always_inline))
+void voice_bank_group_process (voice_bank_t *bank,
+                               size_t g,
+                               sample_t (*busses)[N_FRAMES_BLOCK],
+                               size_t n_sends,
+                               size_t n_samples,
+                               bool bypassed,
+                               bool sent) {
+
+    size_t i;
+    size_t l;
+
+    lane_t state_transition_damper = bank->state_transition_damper[g];
+    lane_t state_transition_finger = bank->state_transition_finger[g];
+    lane_t state_dc_blocker = bank->state_dc_blocker[g];
+    lane_t state_damper = bank->state_damper[g];
+    lane_t state_finger = bank->state_finger[g];
+    lane_t state_bridge_output = bank->state_bridge_output[g];
+
+    lane_t k_transition_damper = bank->k_transition_damper[g];
+    lane_t k_transition_finger = bank->k_transition_finger[g];
+    lane_t k_dc_blocker = bank->k_dc_blocker[g];
+    lane_t k_damper = bank->k_damper[g];
+    lane_t k_finger = bank->k_finger[g];
+    lane_t k_bridge_output = bank->k_bridge_output[g];
+    lane_t pass_bridge_output = bank->pass_bridge_output[g];
+    lane_t target_coefficient_damper = bank->target_coefficient_damper[g];
+    lane_t target_coefficient_finger = bank->target_coefficient_finger[g];
+    lane_t admittance = bank->admittance[g];
+    lane_t pan_left = bank->pan_left[g];
+    lane_t pan_right = bank->pan_right[g];
+    lane_t *interpolation = bank->interpolation[g];
+
+    sample_t **pointers = bank->pointers + g * N_LANES;
+    sample_t **reads = bank->reads + g * N_LANES;
+    sample_t **heads = bank->heads + g * N_LANES;
+    sample_t **tails = bank->tails + g * N_LANES;
+
+    /* gather the taps, with the ones the interpolator needs from before the block */
+    for (l = 0; l < N_LANES; l++)
+        voice_bank_gather (bank->taps, l, reads[l], heads[l], tails[l],
+                           n_samples + DELAY_INTERPOLATION_ORDER);
+
+    for (i = 0; i < n_samples; i++) {
+
+        size_t k;
+        lane_t delay = interpolation[0] * bank->taps[i + DELAY_INTERPOLATION_ORDER];
+        lane_t dc_blocker;
+        lane_t damper_damped;
+        lane_t pre_termination;
+        lane_t finger_damped;
+        lane_t termination;
+        lane_t body;
+
+        /* transitions */
+        state_transition_damper += k_transition_damper * (target_coefficient_damper - state_transition_damper);
+        state_transition_finger += k_transition_finger * (target_coefficient_finger - state_transition_finger);
+
+        /* fractional delay */
+        for (k = 1; k <= DELAY_INTERPOLATION_ORDER; k++)
+            delay += interpolation[k] * bank->taps[i + DELAY_INTERPOLATION_ORDER - k];
+
+        /* dc blocker */
+        state_dc_blocker += k_dc_blocker * (delay - state_dc_blocker);
+        dc_blocker = delay - state_dc_blocker;
+
+        /* damper */
+        damper_damped = state_transition_damper * dc_blocker;
+        state_damper += k_damper * (damper_damped - state_damper);
+        pre_termination = state_damper + dc_blocker - damper_damped;
+
+        /* finger */
+        finger_damped = state_transition_finger * pre_termination;
+        state_finger += k_finger * (finger_damped - state_finger);
+        termination = state_finger + pre_termination - finger_damped;
+
+        /* termination */
+        state_bridge_output += k_bridge_output * ((bypassed ? pass_bridge_output * termination : termination)
+                                                  - state_bridge_output);
+        body = termination - state_bridge_output;
+        bank->output[i] = body;
+        bank->left[i] += pan_left * body;
+        bank->right[i] += pan_right * body;
+        if (sent)
+            bank->send[i] += admittance * body;
+        bank->taps[i] = state_bridge_output;
+    }
+
+    /* stems and pitch classes */
+    for (l = 0; l < N_LANES; l++) {
+
+        size_t i_voice = g * N_LANES + l;
+
+        if (!bank->voices[i_voice])
+            continue;
+
+        if (OUTPUT_N_STEMS) {
+
+            sample_t *stem = busses[BUS_STEM + bank->stems[i_voice]];
+            for (i = 0; i < n_samples; i++)
+                stem[i] += bank->output[i][l];
+        }
+
+        if (n_sends > 1) {
+
+            sample_t *send = busses[BUS_SEND + 1 + bank->pitch_classes[i_voice]];
+            for (i = 0; i < n_samples; i++)
+                send[i] += admittance[l] * bank->output[i][l];
+        }
+    }
+
+    /* scatter the reflections */
+    for (l = 0; l < N_LANES; l++) {
+
+        voice_bank_scatter (bank->taps, l, pointers[l], heads[l], tails[l], n_samples);
+        pointers[l] = voice_bank_advance (pointers[l], heads[l], tails[l], n_samples);
+        reads[l] = voice_bank_advance (reads[l], heads[l], tails[l], n_samples);
+    }
+
+    bank->state_transition_damper[g] = state_transition_damper;
+    bank->state_transition_finger[g] = state_transition_finger;
+    bank->state_dc_blocker[g] = state_dc_blocker;
+    bank->state_damper[g] = state_damper;
+    bank->state_finger[g] = state_finger;
+    bank->state_bridge_output[g] = state_bridge_output;
+}
+
+/* mixes the strings into busses, the first n_sends of the ones from BUS_SEND,
+ * see coupling_t; the panned busses and the bridge are accumulated across lanes,
+ * the stems and pitch classes are scattered lane by lane */
+void voice_bank_process_block (voice_bank_t *bank,
+                               sample_t (*busses)[N_FRAMES_BLOCK],
+                               size_t n_sends,
+                               size_t n_samples) {
+
+    size_t g;
+    size_t i;
+
+    memset (bank->left, 0, sizeof (lane_t) * n_samples);
+    memset (bank->right, 0, sizeof (lane_t) * n_samples);
+    memset (bank->send, 0, sizeof (lane_t) * n_samples);
+
+    for (g = 0; g < bank->n_groups; g++) {
+
+        if (bank->bypassed && n_sends)
+            voice_bank_group_process (bank, g, busses, n_sends, n_samples, true, true);
+        else if (bank->bypassed)
+            voice_bank_group_process (bank, g, busses, n_sends, n_samples, true, false);
+        else if (n_sends)
+            voice_bank_group_process (bank, g, busses, n_sends, n_samples, false, true);
+        else
+            voice_bank_group_process (bank, g, busses, n_sends, n_samples, false, false);
+    }
+
+    for (i = 0; i < n_samples; i++) {
+
+        size_t l;
+        for (l = 0; l < N_LANES; l++) {
+
+            busses[BUS_LEFT][i] += bank->left[i][l];
+            busses[BUS_RIGHT][i] += bank->right[i][l];
+        }
+    }
+
+    if (n_sends)
+        for (i = 0; i < n_samples; i++) {
+
+            size_t l;
+            for (l = 0; l < N_LANES; l++)
+                busses[BUS_SEND][i] += bank->send[i][l];
+        }
+}
+
+/* one group of voice_bank_input_block, inlined into a copy for each case as
+ * voice_input_kernel is */
+static __inline__ __attribute__ ((always_inline))
+void voice_bank_group_input (voice_bank_t *bank,
+                             size_t g,
+                             sample_t (*inputs)[N_FRAMES_BLOCK],
+                             size_t n_inputs,
+                             size_t n_samples,
+                             bool coupled,
+                             bool scaled) {
+
+    size_t i;
+    size_t l;
+    lane_t state_bridge_input = bank->state_bridge_input[g];
+    lane_t k_bridge_input = bank->k_bridge_input[g];
+    lane_t pass_bridge_input = bank->pass_bridge_input[g];
+
+    if (coupled && n_inputs > 1) {
+
+        sample_t *channels[N_LANES];
+        for (l = 0; l < N_LANES; l++)
+            channels[l] = inputs[bank->pitch_classes[g * N_LANES + l]];
+
+        for (i = 0; i < n_samples; i++) {
+
+            lane_t input;
+            for (l = 0; l < N_LANES; l++)
+                input[l] = channels[l][i];
+            state_bridge_input += k_bridge_input * ((scaled ? pass_bridge_input * input : input) - state_bridge_input);
+            bank->taps[i] = state_bridge_input;
+        }
+
+    } else if (coupled) {
+
+        for (i = 0; i < n_samples; i++) {
+
+            if (scaled)
+                state_bridge_input += k_bridge_input * (pass_bridge_input * inputs[0][i] - state_bridge_input);
+            else
+                state_bridge_input += k_bridge_input * (inputs[0][i] - state_bridge_input);
+            bank->taps[i] = state_bridge_input;
+        }
+    }
+
+    bank->state_bridge_input[g] = state_bridge_input;
+
+    for (l = 0; l < N_LANES; l++) {
+
+        size_t i_voice = g * N_LANES + l;
+        sample_t *head = bank->heads[i_voice];
+        sample_t *tail = bank->tails[i_voice];
+        sample_t *pointer = voice_bank_advance (bank->pointers[i_voice], head, tail,
+                                              (tail - head) - n_samples % (tail - head));
+        double peak = bank->peaks[i_voice];
+        size_t i_period = bank->i_periods[i_voice];
+        size_t n_period = bank->n_periods[i_voice];
+
+        for (i = 0; i < n_samples; i++) {
+
+            double delay = coupled ? *pointer += bank->taps[i][l] : *pointer;
+
+            /* activity */
+            delay = fabs (delay);
+            if (delay > peak)
+                peak = delay;
+            if (++i_period >= n_period) {
+
+                bank->peaks_period[i_voice] = peak;
+                peak = 0;
+                i_period = 0;
+            }
+            if (++pointer >= tail)
+                pointer = head;
+        }
+
+        bank->peaks[i_voice] = peak;
+        bank->i_periods[i_voice] = i_period;
+    }
+}
+
+/* every string hears the input of its pitch class, or the first with a single one,
+ * or none at all without coupling */
+void voice_bank_input_block (voice_bank_t *bank,
+                             sample_t (*inputs)[N_FRAMES_BLOCK],
+                             size_t n_inputs,
+                             size_t n_samples) {
+
+    size_t g;
+
+    for (g = 0; g < bank->n_groups; g++) {
+
+        if (!n_inputs)
+            voice_bank_group_input (bank, g, inputs, n_inputs, n_samples, false, false);
+        else if (bank->scaled)
+            voice_bank_group_input (bank, g, inputs, n_inputs, n_samples, true, true);
+        else
+            voice_bank_group_input (bank, g, inputs, n_inputs, n_samples, true, false);
+    }
+}
+
+/* just enough complex arithmetic to fit modes with */
+typedef struct complex_t {
+
+    double real;
+    double imaginary;
+
+} complex_t;
+
+static complex_t complex_make (double real, double imaginary) {
+
+    complex_t z;
+    z.real = real;
+    z.imaginary = imaginary;
+    return z;
+}
+
+static complex_t complex_polar (double magnitude, double phase) {
+
+    return complex_make (magnitude * cos (phase), magnitude * sin (phase));
+}
+
+static complex_t complex_multiply (complex_t a, complex_t b) {
+
+    return complex_make (a.real * b.real - a.imaginary * b.imaginary,
+                         a.real * b.imaginary + a.imaginary * b.real);
+}
+
+static complex_t complex_divide (complex_t a, complex_t b) {
+
+    double norm = b.real * b.real + b.imaginary * b.imaginary;
+    return complex_make ((a.real * b.real + a.imaginary * b.imaginary) / norm,
+                         (a.imaginary * b.real - a.real * b.imaginary) / norm);
+}
+
+/* a string as a bank of decaying complex resonators, one per partial, each
+ * one a root of the waveguide's own loop: the line, its interpolator and the
+ * filters of voice_process_block with the transitions where they are; high up
+ * where the lines are a handful of samples long it costs a few lanes per
+ * string rather than the cascade per sample, and tunes without rounding */
+typedef struct modal_t {
+
+    lane_t state_real[N_MODAL_GROUPS];
+    lane_t state_imaginary[N_MODAL_GROUPS];
+    lane_t pole_real[N_MODAL_GROUPS];
+    lane_t pole_imaginary[N_MODAL_GROUPS];
+    lane_t pole_squared_real[N_MODAL_GROUPS];   /* two samples on, see modal_step */
+    lane_t pole_squared_imaginary[N_MODAL_GROUPS];
+    lane_t gain_real[N_MODAL_GROUPS];           /* of the plucks, laid in where the line is read */
+    lane_t gain_imaginary[N_MODAL_GROUPS];
+    lane_t gain_pole_real[N_MODAL_GROUPS];      /* the same a sample on */
+    lane_t gain_pole_imaginary[N_MODAL_GROUPS];
+    lane_t gain_input_real[N_MODAL_GROUPS];     /* of the bridge, where the line is written */
+    lane_t gain_input_imaginary[N_MODAL_GROUPS];
+    lane_t gain_input_pole_real[N_MODAL_GROUPS];
+    lane_t gain_input_pole_imaginary[N_MODAL_GROUPS];
+    double omegas[MODAL_N_MODES];               /* rad per sample */
+
+    /* what they were fitted to, see modal_fit */
+    double length;
+    double damper;
+    double finger;
+
+} modal_t;
+
+void modal_init (modal_t *modal) {
+
+    memset (modal, 0, sizeof (modal_t));
+}
+
+void modal_terminate (modal_t *modal) {
+
+}
+
+/* the one pole lowpass of filter_process with coefficient k, at z to the -1 */
+static complex_t modal_lowpass (double k, complex_t z) {
+
+    return complex_divide (complex_make (k, 0), complex_make (1 - (1 - k) * z.real, -(1 - k) * z.imaginary));
+}
+
+/* a lowpass blended in by transition over its own input, as the damper and finger are */
+static complex_t modal_blend (double k, double transition, complex_t z) {
+
+    complex_t lowpass = modal_lowpass (k, z);
+    return complex_make (1 - transition + transition * lowpass.real, transition * lowpass.imaginary);
+}
+
+/* voice_process_block at omega with the transitions at damper and finger, around
+ * the loop from a sample written back to the one written from it, and out from
+ * a sample read to what the string gives the bridge */
+static void modal_response (const voice_t *voice, double damper, double finger, double omega,
+                            complex_t *loop, complex_t *output) {
+
+    size_t k;
+    complex_t z = complex_polar (1, -omega);
+    complex_t power = complex_make (1, 0);
+    complex_t termination = complex_make (0, 0);
+    complex_t reflection;
+    complex_t lowpass;
+    double pass = 1 - voice->bridge_output.coefficient_bypass;
+
+    /* fractional delay */
+    for (k = 0; k <= DELAY_INTERPOLATION_ORDER; k++) {
+
+        termination.real += voice->interpolation[k] * power.real;
+        termination.imaginary += voice->interpolation[k] * power.imaginary;
+        power = complex_multiply (power, z);
+    }
+
+    /* dc blocker, damper and finger */
+    lowpass = modal_lowpass (voice->filter_dc_blocker.coefficient, z);
+    termination = complex_multiply (termination, complex_make (1 - lowpass.real, -lowpass.imaginary));
+    termination = complex_multiply (termination, modal_blend (voice->filter_damper.coefficient, damper, z));
+    termination = complex_multiply (termination, modal_blend (voice->filter_finger.coefficient, finger, z));
+
+    /* termination */
+    lowpass = modal_lowpass (voice->bridge_output.filter.coefficient, z);
+    reflection = complex_multiply (termination, complex_make (pass * lowpass.real, pass * lowpass.imaginary));
+    *loop = complex_multiply (reflection, complex_polar (1, -omega * voice->delay.n_samples));
+    *output = complex_make (termination.real - reflection.real, termination.imaginary - reflection.imaginary);
+}
+
+/* of the loop at omega, samples */
+static double modal_group_delay (const voice_t *voice, double damper, double finger, double omega) {
+
+    double delta = 1e-4;
+    complex_t above;
+    complex_t below;
+    complex_t output;
+
+    modal_response (voice, damper, finger, omega + delta, &above, &output);
+    modal_response (voice, damper, finger, omega - delta, &below, &output);
+    return -atan2 (above.imaginary * below.real - above.real * below.imaginary,
+                   above.real * below.real + above.imaginary * below.imaginary) / (2 * delta);
+}
+
+/* sets mode i of modal to a pole, weighing the plucks by gain and the bridge by gain_input */
+static void modal_mode_set (modal_t *modal, size_t i, complex_t pole, complex_t gain, complex_t gain_input) {
+
+    size_t g = i / N_LANES;
+    size_t l = i % N_LANES;
+    complex_t pole_squared = complex_multiply (pole, pole);
+    complex_t gain_pole = complex_multiply (gain, pole);
+    complex_t gain_input_pole = complex_multiply (gain_input, pole);
+
+    modal->pole_real[g][l] = pole.real;
+    modal->pole_imaginary[g][l] = pole.imaginary;
+    modal->pole_squared_real[g][l] = pole_squared.real;
+    modal->pole_squared_imaginary[g][l] = pole_squared.imaginary;
+    modal->gain_real[g][l] = gain.real;
+    modal->gain_imaginary[g][l] = gain.imaginary;
+    modal->gain_pole_real[g][l] = gain_pole.real;
+    modal->gain_pole_imaginary[g][l] = gain_pole.imaginary;
+    modal->gain_input_real[g][l] = gain_input.real;
+    modal->gain_input_imaginary[g][l] = gain_input.imaginary;
+    modal->gain_input_pole_real[g][l] = gain_input_pole.real;
+    modal->gain_input_pole_imaginary[g][l] = gain_input_pole.imaginary;
+}
+
+/* the partials of voice with the transitions at damper and finger, tuned by
+ * newton where the loop turns a whole number of times and damped by as much
+ * as it loses per turn; the residues of the loop around them weigh what goes
+ * in, and the real part of each takes in its conjugate */
+void modal_fit (modal_t *modal, const voice_t *voice, double damper, double finger) {
+
+    size_t i;
+    bool retune = fabs (voice->length - modal->length) > MODAL_TOLERANCE * voice->length;
+    complex_t zero = complex_make (0, 0);
+
+    for (i = 0; i < MODAL_N_MODES; i++) {
+
+        size_t j;
+        double omega = retune ? 2 * M_PI * (i + 1) / voice->length : modal->omegas[i];
+        double delay;
+        double magnitude;
+        complex_t loop;
+        complex_t output;
+        complex_t gain;
+        complex_t pole;
+        complex_t gain_input;
+
+        for (j = 0; j < (retune ? MODAL_N_ITERATIONS : 1) && omega > 0 && omega < M_PI; j++) {
+
+            modal_response (voice, damper, finger, omega, &loop, &output);
+            delay = modal_group_delay (voice, damper, finger, omega);
+            omega += atan2 (loop.imaginary, loop.real) / delay;
+        }
+        modal->omegas[i] = omega;
+
+        /* left out past nyquist */
+        if (omega <= 0 || omega >= M_PI) {
+
+            modal_mode_set (modal, i, zero, zero, zero);
+            modal->state_real[i / N_LANES][i % N_LANES] = 0;
+            modal->state_imaginary[i / N_LANES][i % N_LANES] = 0;
+            continue;
+        }
+
+        modal_response (voice, damper, finger, omega, &loop, &output);
+        delay = modal_group_delay (voice, damper, finger, omega);
+        magnitude = sqrt (loop.real * loop.real + loop.imaginary * loop.imaginary);
+
+        pole = complex_polar (magnitude < 1 ? pow (magnitude, 1 / delay) : 1, omega);
+        gain = complex_make (2 * output.real / delay, 2 * output.imaginary / delay);
+        gain_input = complex_multiply (gain, complex_polar (1, -omega * voice->delay.n_samples));
+
+        modal_mode_set (modal, i, pole, gain, gain_input);
+    }
+
+    for (i = MODAL_N_MODES; i < N_MODAL_GROUPS * N_LANES; i++)
+        modal_mode_set (modal, i, zero, zero, zero);
+
+    modal->length = voice->length;
+    modal->damper = damper;
+    modal->finger = finger;
+}
+
+/* runs the modes on from state over n_samples of input weighed by gain, gain_pole
+ * being it a sample on, writing their sum to output unless NULL; two samples at
+ * a time by the pole squared, so the recursions wait on each other half as often */
+static void modal_step (const modal_t *modal, lane_t *states_real, lane_t *states_imaginary,
+                        const lane_t *gain_real, const lane_t *gain_imaginary,
+                        const lane_t *gain_pole_real, const lane_t *gain_pole_imaginary,
+                        const sample_t *input, sample_t *output, size_t n_samples) {
+
+    size_t g;
+    size_t i;
+    lane_t zero = { 0 };
+    lane_t state_real[N_MODAL_GROUPS];
+    lane_t state_imaginary[N_MODAL_GROUPS];
+
+    memcpy (state_real, states_real, sizeof (state_real));
+    memcpy (state_imaginary, states_imaginary, sizeof (state_imaginary));
+
+    for (i = 0; i + 1 < n_samples; i += 2) {
+
+        size_t l;
+        lane_t sum_first = zero;
+        lane_t sum_second = zero;
+        state_t x_first = input[i];
+        state_t x_second = input[i + 1];
+        double y_first = 0;
+        double y_second = 0;
+
+        for (g = 0; g < N_MODAL_GROUPS; g++) {
+
+            lane_t real_first = modal->pole_real[g] * state_real[g] - modal->pole_imaginary[g] * state_imaginary[g]
+                              + gain_real[g] * x_first;
+            lane_t real = modal->pole_squared_real[g] * state_real[g]
+                        - modal->pole_squared_imaginary[g] * state_imaginary[g]
+                        + gain_pole_real[g] * x_first + gain_real[g] * x_second;
+            state_imaginary[g] = modal->pole_squared_real[g] * state_imaginary[g]
+                               + modal->pole_squared_imaginary[g] * state_real[g]
+                               + gain_pole_imaginary[g] * x_first + gain_imaginary[g] * x_second;
+            state_real[g] = real;
+            sum_first += real_first;
+            sum_second += real;
+        }
+
+        if (!output)
+            continue;
+        for (l = 0; l < N_LANES; l++) {
+
+            y_first += sum_first[l];
+            y_second += sum_second[l];
+        }
+        output[i] = y_first;
+        output[i + 1] = y_second;
+    }
+
+    if (i < n_samples) {
+
+        size_t l;
+        lane_t sum = zero;
+        state_t x = input[i];
+        double y = 0;
+
+        for (g = 0; g < N_MODAL_GROUPS; g++) {
+
+            lane_t real = modal->pole_real[g] * state_real[g] - modal->pole_imaginary[g] * state_imaginary[g]
+                        + gain_real[g] * x;
+            state_imaginary[g] = modal->pole_real[g] * state_imaginary[g] + modal->pole_imaginary[g] * state_real[g]
+                               + gain_imaginary[g] * x;
+            state_real[g] = real;
+            sum += real;
+        }
+
+        if (output) {
+
+            for (l = 0; l < N_LANES; l++)
+                y += sum[l];
+            output[i] = y;
+        }
+    }
+
+    memcpy (states_real, state_real, sizeof (state_real));
+    memcpy (states_imaginary, state_imaginary, sizeof (state_imaginary));
+}
+
+/* runs voice as its modes for n_samples plucked by excitation, see
+ * voice_excite_buffer, writing what it gives the bridge to output; the
+ * transitions move on as in voice_process_block, the modes refitted every
+ * MODAL_N_FRAMES_FIT while they do to where they are halfway on, once they
+ * or the length moved further than MODAL_TOLERANCE */
+void modal_process_block (modal_t *modal, voice_t *voice, const sample_t *excitation,
+                          sample_t *output, size_t n_samples) {
+
+    size_t i;
+    state_t state_transition_damper = voice->filter_transition_damper.state;
+    state_t state_transition_finger = voice->filter_transition_finger.state;
+    state_t k_transition_damper = voice->filter_transition_damper.coefficient;
+    state_t k_transition_finger = voice->filter_transition_finger.coefficient;
+    state_t target_coefficient_damper = voice->target_coefficient_damper;
+    state_t target_coefficient_finger = voice->sustain * voice->target_coefficient_finger;
+    double peak = voice->peak;
+    size_t i_period = voice->i_period;
+
+    /* how much of the way the transitions have left to go halfway on */
+    double decay_damper = pow (1 - k_transition_damper, MODAL_N_FRAMES_FIT / 2);
+    double decay_finger = pow (1 - k_transition_finger, MODAL_N_FRAMES_FIT / 2);
+
+    while (n_samples) {
+
+        size_t n = n_samples < MODAL_N_FRAMES_FIT ? n_samples : MODAL_N_FRAMES_FIT;
+        double damper;
+        double finger;
+
+        /* with both settled within the tolerance of the fit, the rest in one go */
+        if (fabs (state_transition_damper - target_coefficient_damper) < MODAL_TOLERANCE / 2
+            && fabs (modal->damper - target_coefficient_damper) < MODAL_TOLERANCE / 2
+            && fabs (state_transition_finger - target_coefficient_finger) < MODAL_TOLERANCE / 2
+            && fabs (modal->finger - target_coefficient_finger) < MODAL_TOLERANCE / 2
+            && fabs (voice->length - modal->length) <= MODAL_TOLERANCE * voice->length)
+            n = n_samples;
+
+        if (n < MODAL_N_FRAMES_FIT) {
+
+            decay_damper = pow (1 - k_transition_damper, n / 2.0);
+            decay_finger = pow (1 - k_transition_finger, n / 2.0);
+        }
+        damper = target_coefficient_damper + (state_transition_damper - target_coefficient_damper) * decay_damper;
+        finger = target_coefficient_finger + (state_transition_finger - target_coefficient_finger) * decay_finger;
+
+        if (fabs (damper - modal->damper) > MODAL_TOLERANCE
+            || fabs (finger - modal->finger) > MODAL_TOLERANCE
+            || fabs (voice->length - modal->length) > MODAL_TOLERANCE * voice->length)
+            modal_fit (modal, voice, damper, finger);
+
+        modal_step (modal, modal->state_real, modal->state_imaginary,
+                    modal->gain_real, modal->gain_imaginary, modal->gain_pole_real, modal->gain_pole_imaginary,
+                    excitation, output, n);
+
+        /* activity */
+        for (i = 0; i < n; i++) {
+
+            double y = fabs (output[i]);
+            if (y > peak)
+                peak = y;
+            if (++i_period >= voice->delay.n_samples) {
+
+                voice->peak_period = peak;
+                peak = 0;
+                i_period = 0;
+            }
+        }
+
+        /* transitions, the rest of the way on */
+        state_transition_damper = target_coefficient_damper
+                                + (state_transition_damper - target_coefficient_damper) * decay_damper * decay_damper;
+        state_transition_finger = target_coefficient_finger
+                                + (state_transition_finger - target_coefficient_finger) * decay_finger * decay_finger;
+
+        excitation += n;
+        output += n;
+        n_samples -= n;
+    }
+
+    voice->filter_transition_damper.state = state_transition_damper;
+    voice->filter_transition_finger.state = state_transition_finger;
+    voice->peak = peak;
+    voice->i_period = i_period;
+}
+
+/* feeds n_samples of input through the bridge to the modes of voice, after
+ * modal_process_block as voice_input_block after voice_process_block; what
+ * the input rings the modes with over the block is run on its own and added
+ * to where modal_process_block left them; NULL for none without coupling */
+void modal_input_block (modal_t *modal, voice_t *voice, const sample_t *input, size_t n_samples) {
+
+    size_t g;
+    size_t i;
+    lane_t zero = { 0 };
+    lane_t state_real[N_MODAL_GROUPS];
+    lane_t state_imaginary[N_MODAL_GROUPS];
+    sample_t transmitted[N_FRAMES_BLOCK];
+    state_t state_bridge_input = voice->bridge_input.filter.state;
+    state_t k_bridge_input = voice->bridge_input.filter.coefficient;
+    state_t pass_bridge_input = voice->admittance * (1 - voice->bridge_input.coefficient_bypass);
+
+    if (!input)
+        return;
+
+    for (i = 0; i < n_samples; i++) {
+
+        state_bridge_input += k_bridge_input * (pass_bridge_input * input[i] - state_bridge_input);
+        transmitted[i] = state_bridge_input;
+    }
+
+    for (g = 0; g < N_MODAL_GROUPS; g++)
+        state_real[g] = state_imaginary[g] = zero;
+
+    modal_step (modal, state_real, state_imaginary,
+                modal->gain_input_real, modal->gain_input_imaginary,
+                modal->gain_input_pole_real, modal->gain_input_pole_imaginary,
+                transmitted, NULL, n_samples);
+
+    for (g = 0; g < N_MODAL_GROUPS; g++) {
+
+        modal->state_real[g] += state_real[g];
+        modal->state_imaginary[g] += state_imaginary[g];
+    }
+    voice->bridge_input.filter.state = state_bridge_input;
+}
+
+/* by interval in semitones, how well the partials of two strings line up */
+static const double coupling_affinity[N_PITCH_CLASSES] = { 1, 0, 0, 0.2, 0.3, 0.5, 0, 0.5, 0.3, 0.2, 0, 0 };
+
+/* sympathetic coupling, a low rank stand in for the full string to string matrix:
+ * every string drives the bridge in proportion to its admittance and hears it back
+ * the same way; with coupling_harmonic part of it goes through one channel per
+ * pitch class instead, heard the more by a string the better its partials line up;
+ * without sympathetic_resonance there is none, and the strings run without */
+typedef struct coupling_t {
+
+    size_t n_sends;                                     /* 0, 1, or N_COUPLING_CHANNELS */
+    size_t n_inputs;                                    /* 0, 1, or N_PITCH_CLASSES */
+    double mix[N_PITCH_CLASSES][N_COUPLING_CHANNELS];   /* from sends to inputs */
+    sample_t inputs[N_PITCH_CLASSES][N_FRAMES_BLOCK];
+    double peaks[N_PITCH_CLASSES];                      /* loudest of each input over the last block */
+    sample_t last[N_COUPLING_CHANNELS];                 /* sent at the end of the previous block */
+
+} coupling_t;
+
+void coupling_init (coupling_t *coupling, const patch_t *patch) {
+
+    size_t i;
+    size_t j;
+    double affinity = 0;
+    double gain = patch->sympathetic_resonance / (double) N_VOICES;
+
+    memset (coupling, 0, sizeof (coupling_t));
+
+    if (!gain)
+        return;
+
+    if (!patch->coupling_harmonic) {
+
+        coupling->n_sends = coupling->n_inputs = 1;
+        coupling->mix[0][0] = gain;
+        return;
+    }
+
+    coupling->n_sends = N_COUPLING_CHANNELS;
+    coupling->n_inputs = N_PITCH_CLASSES;
+
+    for (i = 0; i < N_PITCH_CLASSES; i++)
+        affinity += coupling_affinity[i];
+
+    /* a pitch class carries about a twelfth of the strings */
+    for (i = 0; i < N_PITCH_CLASSES; i++) {
+
+        coupling->mix[i][0] = (1 - patch->coupling_harmonic) * gain;
+        for (j = 0; j < N_PITCH_CLASSES; j++)
+            coupling->mix[i][1 + j] = patch->coupling_harmonic * gain * N_PITCH_CLASSES / affinity
+                                    * coupling_affinity[(j + N_PITCH_CLASSES - i) % N_PITCH_CLASSES];
+    }
+}
+
+void coupling_terminate (coupling_t *coupling) {
+
+}
+
+/* which of inputs, the coupling's own or the same oversampled, a string hears;
+ * NULL for none when there is no coupling */
+sample_t *coupling_input (coupling_t *coupling, sample_t (*inputs)[N_FRAMES_BLOCK], voice_t *voice) {
+
+    if (!coupling->n_inputs)
+        return NULL;
+
+    return inputs[coupling->n_inputs > 1 ? voice->note % N_PITCH_CLASSES : 0];
+}
+
+/* mixes the sends of a block into the inputs, one sample later,
+ * keeping the loudest of each */
+void coupling_process (coupling_t *coupling, sample_t (*sends)[N_FRAMES_BLOCK], size_t n_samples) {
+
+    size_t i;
+    size_t j;
+    size_t k;
+
+    for (i = 0; i < coupling->n_inputs; i++) {
+
+        sample_t *input = coupling->inputs[i];
+        double peak = 0;
+
+        memset (input, 0, sizeof (sample_t) * n_samples);
+        for (j = 0; j < coupling->n_sends; j++) {
+
+            sample_t *send = sends[j];
+            double mix = coupling->mix[i][j];
+
+            /* most pitch classes are unrelated */
+            if (!mix)
+                continue;
+
+            input[0] += mix * coupling->last[j];
+            for (k = 1; k < n_samples; k++)
+                input[k] += mix * send[k - 1];
+        }
+
+        for (k = 0; k < n_samples; k++)
+            if (fabs (input[k]) > peak)
+                peak = fabs (input[k]);
+        coupling->peaks[i] = peak;
+    }
+
+    for (j = 0; j < coupling->n_sends; j++)
+        coupling->last[j] = sends[j][n_samples - 1];
+}
+
+/* the loudest a string heard over the last block, through its bridge filter */
+double coupling_peak (coupling_t *coupling, voice_t *voice) {
+
+    if (!coupling->n_inputs)
+        return 0;
+
+    return voice->admittance * (1 - voice->bridge_input.coefficient_bypass)
+         * coupling->peaks[coupling->n_inputs > 1 ? voice->note % N_PITCH_CLASSES : 0];
+}
+
+typedef struct resonator_t {
+
+    convolver_t convolver;
+    double resonance;               /* share of the body in the output, the rest dry */
+
+} resonator_t;
+
+void resonator_init (resonator_t *resonator, double resonance) {
+
+    memset (resonator, 0, sizeof (resonator_t));
+    convolver_init (&resonator->convolver);
+    resonator->resonance = resonance;
+}
+
+void resonator_terminate (resonator_t *resonator) {
+
+    convolver_terminate (&resonator->convolver);
+}
+
+void resonator_process_block (resonator_t *resonator,
+                              const sample_t *input,
+                              sample_t *output,
+                              size_t n_samples) {
+
+    size_t i;
+
+    /* all dry leaves the convolver idle, and all body needs no mixing */
+    if (!resonator->resonance) {
+
+        memcpy (output, input, sizeof (sample_t) * n_samples);
+        return;
+    }
+
+    convolver_process_block (&resonator->convolver, input, output, n_samples);
+    if (resonator->resonance != 1)
+        for (i = 0; i < n_samples; i++)
+            output[i] = lerp (resonator->resonance, input[i], output[i]);
+}
+
+/* the plucks of the strings already through the body, for commuted synthesis:
+ * string and body being linear, plucking a string with what the body makes
+ * of the pluck sounds the same as running the plucked string through the
+ * body, without a convolver; the strike is always central, and a velocity
+ * only scales it so one per string does for all of them */
+typedef struct excitations_t {
+
+    buffer_t plucks[N_VOICES];              /* at the rate, empty for the strings not played */
+    buffer_t plucks_oversampled[N_VOICES];  /* of the oversampled strings, at their own rate */
+    size_t n_frames;                        /* at the rate, the longest any of them lasts */
+
+} excitations_t;
+
+void excitations_destroy (excitations_t *excitations) {
+
+    size_t i;
+
+    if (!excitations)
+        return;
+
+    for (i = 0; i < N_VOICES; i++) {
+
+        buffer_terminate (&excitations->plucks[i]);
+        buffer_terminate (&excitations->plucks_oversampled[i]);
+    }
+    free (excitations);
+}
+
+/* the plucks of voices from voice_min up to voice_max at rate into plucks,
+ * convolved with body, which is at that rate already */
+static void excitations_pluck (buffer_t *plucks, const voice_t *voices, int voice_min, int voice_max,
+                               const buffer_t *body, double rate) {
+
+    int i;
+    size_t n_points = 1;
+    size_t n_period_max = 0;
+    size_t n_body = body->n_samples;
+    sample_t *body_real;
+    sample_t *body_imaginary;
+    sample_t *real;
+    sample_t *imaginary;
+    fft_t fft;
+
+    for (i = voice_min; i < voice_max; i++)
+        if (n_period_max < delay_length_whole (rate / voices[i].frequency))
+            n_period_max = delay_length_whole (rate / voices[i].frequency);
+    while (n_points < n_period_max + n_body)
+        n_points <<= 1;
+
+    fft_init (&fft, n_points);
+    body_real = calloc (n_points, sizeof (sample_t));
+    body_imaginary = calloc (n_points, sizeof (sample_t));
+    real = calloc (n_points, sizeof (sample_t));
+    imaginary = calloc (n_points, sizeof (sample_t));
+
+    memcpy (body_real, body->data, sizeof (sample_t) * n_body);
+    fft_process (&fft, body_real, body_imaginary, false);
+
+    for (i = voice_min; i < voice_max; i++) {
+
+        size_t j;
+        size_t n_period = delay_length_whole (rate / voices[i].frequency);
+        size_t n_samples = n_period + n_body - 1;
+        sample_t *data = calloc (n_samples, sizeof (sample_t));
+
+        /* the bare pluck the way voice_excite_block lays it in */
+        memset (real, 0, sizeof (sample_t) * n_points);
+        memset (imaginary, 0, sizeof (sample_t) * n_points);
+        for (j = 0; j < n_period; j++)
+            real[j] = voice_pluck (j / (double) n_period * 2, voices[i].patch->hammer_strike_position_center) / 2;
+
+        fft_process (&fft, real, imaginary, false);
+        for (j = 0; j < n_points; j++) {
+
+            sample_t product_real = real[j] * body_real[j] - imaginary[j] * body_imaginary[j];
+            sample_t product_imaginary = real[j] * body_imaginary[j] + imaginary[j] * body_real[j];
+            real[j] = product_real;
+            imaginary[j] = product_imaginary;
+        }
+        fft_process (&fft, real, imaginary, true);
+
+        for (j = 0; j < n_samples; j++)
+            data[j] = real[j] / n_points;
+        buffer_terminate (&plucks[i]);
+        buffer_init (&plucks[i], n_samples, data);
+    }
+
+    fft_terminate (&fft);
+    free (body_real);
+    free (body_imaginary);
+    free (real);
+    free (imaginary);
+}
+
+/* halves the rate through a half-band lowpass; every other one of its taps is
+ * zero but the centre one, which leaves a symmetric filter over the even input
+ * samples and a delay of the odd ones, run N_LANES outputs at a time */
+typedef struct half_band_t {
+
+    state_t taps[HALF_BAND_N_TAPS];     /* from the centre out, the centre one being a half */
+    state_t even[2 * HALF_BAND_N_TAPS + N_FRAMES_BLOCK / 2];    /* the last of the previous block first */
+    state_t odd[2 * HALF_BAND_N_TAPS + N_FRAMES_BLOCK / 2];
+
+} half_band_t;
+
+void half_band_init (half_band_t *half_band) {
+
+    size_t k;
+    double sum = 0;
+
+    memset (half_band, 0, sizeof (half_band_t));
+
+    /* blackman windowed sinc cut off at half the rate it brings it down to */
+    for (k = 0; k < HALF_BAND_N_TAPS; k++) {
+
+        double offset = 2 * k + 1;
+        double phase = M_PI * offset / (2 * HALF_BAND_N_TAPS);
+        double window = 0.42 + 0.5 * cos (phase) + 0.08 * cos (2 * phase);
+
+        half_band->taps[k] = (k % 2 ? -1 : 1) / (M_PI * offset) * window;
+        sum += half_band->taps[k];
+    }
+
+    /* unity at dc */
+    for (k = 0; k < HALF_BAND_N_TAPS; k++)
+        half_band->taps[k] *= 0.25 / sum;
+}
+
+void half_band_terminate (half_band_t *half_band) {
+
+}
+
+static lane_t half_band_load (const state_t *pointer) {
+
+    lane_t lane;
+    memcpy (&lane, pointer, sizeof (lane_t));
+    return lane;
+}
+
+/* decimates 2 n_samples of input into n_samples of output, N_FRAMES_BLOCK / 2 at most,
+ * HALF_BAND_N_TAPS * 2 - 1 input samples late; input and output may be the same buffer */
+void half_band_process (half_band_t *half_band, const sample_t *input, sample_t *output, size_t n_samples) {
+
+    size_t i;
+    size_t k;
+    state_t *even = half_band->even + 2 * HALF_BAND_N_TAPS;
+    state_t *odd = half_band->odd + 2 * HALF_BAND_N_TAPS;
+
+    for (i = 0; i < n_samples; i++) {
+
+        even[i] = input[2 * i];
+        odd[i] = input[2 * i + 1];
+    }
+
+    for (i = 0; i + N_LANES <= n_samples; i += N_LANES) {
+
+        lane_t sum = 0.5 * half_band_load (odd + i - HALF_BAND_N_TAPS);
+
+        for (k = 0; k < HALF_BAND_N_TAPS; k++)
+            sum += half_band->taps[k] * (half_band_load (even + i - HALF_BAND_N_TAPS - k)
+                                       + half_band_load (even + i - HALF_BAND_N_TAPS + 1 + k));
+
+        for (k = 0; k < N_LANES; k++)
+            output[i + k] = sum[k];
+    }
+
+    for (; i < n_samples; i++) {
+
+        state_t sum = 0.5 * odd[i - HALF_BAND_N_TAPS];
+
+        for (k = 0; k < HALF_BAND_N_TAPS; k++)
+            sum += half_band->taps[k] * (even[i - HALF_BAND_N_TAPS - k] + even[i - HALF_BAND_N_TAPS + 1 + k]);
+        output[i] = sum;
+    }
+
+    memmove (half_band->even, half_band->even + n_samples, sizeof (state_t) * 2 * HALF_BAND_N_TAPS);
+    memmove (half_band->odd, half_band->odd + n_samples, sizeof (state_t) * 2 * HALF_BAND_N_TAPS);
+}
+
+/* a thread running a slice of the active strings for every block */
+typedef struct worker_t {
+
+    struct pool_t *pool;
+    struct synth_t *synth;          /* whose strings, handed over with every block */
+    pthread_t thread;
+    sem_t semaphore;
+
+    voice_bank_t voice_bank;
+    sample_t busses[N_BUSSES][N_FRAMES_BLOCK];
+    sample_t buffer_voice[N_FRAMES_BLOCK];
+    size_t i_voice_first;       /* into synth_t.voices_active */
+    size_t n_voices;
+
+} worker_t;
+
+/* the workers of a process, which its synths take turns at */
+typedef struct pool_t {
+
+    worker_t *workers;
+    size_t n_workers;
+    unsigned int generation;        /* bumped once the sympathetic input is ready */
+    unsigned int n_workers_done;
+    bool running;
+
+} pool_t;
+
+/* a midi channel message stamped with the synth frame it belongs to */
+typedef struct message_t {
+
+    uint64_t frame;
+    jack_midi_data_t data[3];
+
+} message_t;
+
+/* what one period cost the process thread, see synth_period_begin */
+typedef struct telemetry_t {
+
+    uint64_t frame;                 /* at its start */
+    uint32_t n_frames;
+    uint32_t n_voices_max;          /* active at once */
+    uint32_t n_notes;               /* struck in it */
+    int program;
+    int tier;                       /* the governor had stepped down to */
+    double time_midi;               /* s */
+    double time_strings;            /* waiting for the workers too */
+    double time_resonator;
+    double time;                    /* all of it */
+
+} telemetry_t;
+
+/* what the reporter makes of the periods between two reports */
+typedef struct report_t {
+
+    uint64_t frame;                 /* of the first */
+    size_t n_periods;
+    double time;                    /* s, spent processing */
+    double time_audio;              /* s, the periods held */
+    double load_worst;              /* of a period against its own length */
+    telemetry_t worst;
+    uint32_t n_voices_max;
+    unsigned long n_notes;
+
+} report_t;
+
+/* the read only tables of the synths sharing it, see synth_init_shared: a
+ * coefficient table for each rate and each body with its kernel at each rate,
+ * made by whichever synth asks first and kept until the library goes, so that
+ * the others cost no more than their strings; the bank and the bodies are
+ * looked for under a directory of its own */
+typedef struct library_kernel_t {
+
+    struct library_kernel_t *next;
+    double rate;
+    kernel_t *kernel;
+
+} library_kernel_t;
+
+typedef struct library_body_t {
+
+    struct library_body_t *next;
+    size_t program;                 /* modulo the programs there are */
+    long entry;                     /* in the bank, -1 for paths_impulse_response */
+    buffer_t samples;
+    double rate;
+    library_kernel_t *kernels;
+
+} library_body_t;
+
+typedef struct library_table_t {
+
+    struct library_table_t *next;
+    coefficients_t coefficients;
+
+} library_table_t;
+
+typedef struct library_t {
+
+    char directory[SIZE_PATH];
+    patch_t patch;                  /* the tables are made for */
+    bank_t bank;
+    library_body_t *bodies;
+    library_table_t *tables;
+    pthread_mutex_t mutex;          /* between the threads loading for the synths, never the process threads */
+
+} library_t;
+
+/* with the bodies, PATH_BANK and PATH_PATCH under directory, "" for the working one */
+void library_init (library_t *library, const char *directory) {
+
+    char path[SIZE_PATH];
+
+    memset (library, 0, sizeof (library_t));
+
+    patch_init (&library->patch);
+    if (path_join (library->directory, "", directory) && path_join (path, directory, PATH_PATCH))
+        patch_load (&library->patch, path);
+    if (path_join (path, directory, PATH_BANK))
+        bank_open (&library->bank, path);
+    pthread_mutex_init (&library->mutex, NULL);
+}
+
+/* once every synth sharing it is gone */
+void library_terminate (library_t *library) {
+
+    while (library->bodies) {
+
+        library_body_t *body = library->bodies;
+
+        while (body->kernels) {
+
+            library_kernel_t *kernel = body->kernels;
+            body->kernels = kernel->next;
+            kernel_destroy (kernel->kernel);
+            free (kernel);
+        }
+
+        library->bodies = body->next;
+        buffer_terminate (&body->samples);
+        free (body);
+    }
+
+    while (library->tables) {
+
+        library_table_t *table = library->tables;
+        library->tables = table->next;
+        free (table);
+    }
+
+    bank_close (&library->bank);
+    pthread_mutex_destroy (&library->mutex);
+}
+
+/* the coefficient table for rate */
+const coefficients_t *library_coefficients (library_t *library, double rate) {
+
+    library_table_t *table;
+
+    pthread_mutex_lock (&library->mutex);
+
+    for (table = library->tables; table && table->coefficients.rate != rate; table = table->next)
+        ;
+
+    if (!table) {
+
+        table = malloc (sizeof (library_table_t));
+        coefficients_init (&table->coefficients, &library->patch, rate);
+        table->next = library->tables;
+        library->tables = table;
+    }
+
+    pthread_mutex_unlock (&library->mutex);
+
+    return &table->coefficients;
+}
+
+/* the body of a program as in body_load, its samples staying with the library */
+bool library_body (library_t *library, int program, buffer_t *samples, double *rate, long *entry) {
+
+    library_body_t *body;
+    size_t i = program % bodies_n (&library->bank);
+
+    pthread_mutex_lock (&library->mutex);
+
+    for (body = library->bodies; body && body->program != i; body = body->next)
+        ;
+
+    if (!body) {
+
+        body = calloc (1, sizeof (library_body_t));
+        body->program = i;
+
+        if (!body_load (&library->bank, library->directory, i, &body->samples, &body->rate, &body->entry)) {
+
+            pthread_mutex_unlock (&library->mutex);
+            free (body);
+            return false;
+        }
+
+        body->next = library->bodies;
+        library->bodies = body;
+    }
+
+    *samples = body->samples;
+    *rate = body->rate;
+    *entry = body->entry;
+
+    pthread_mutex_unlock (&library->mutex);
+
+    return true;
+}
+
+/* a kernel_share of the kernel at rate of a body handed out by library_body,
+ * NULL for samples it never did */
+kernel_t *library_kernel (library_t *library, const buffer_t *samples, double rate) {
+
+    library_body_t *body;
+    library_kernel_t *kernel = NULL;
+
+    pthread_mutex_lock (&library->mutex);
+
+    for (body = library->bodies; body && body->samples.data != samples->data; body = body->next)
+        ;
+
+    if (body) {
+
+        for (kernel = body->kernels; kernel && kernel->rate != rate; kernel = kernel->next)
+            ;
+
+        if (!kernel) {
+
+            kernel = malloc (sizeof (library_kernel_t));
+            kernel->rate = rate;
+            kernel->kernel = body_kernel (&library->bank, body->entry, &body->samples, body->rate, rate);
+            kernel->next = body->kernels;
+            body->kernels = kernel;
+        }
+    }
+
+    pthread_mutex_unlock (&library->mutex);
+
+    return kernel ? kernel_share (kernel->kernel) : NULL;
+}
+
+typedef struct synth_t {
+
+    patch_t patch;
+    voice_t voices[N_VOICES];
+    coefficients_t coefficients;      /* unless shared, see synth_rate_set_shared */
+    const coefficients_t *coefficients_rate;    /* of the strings at the rate, this or the shared one */
+    coefficients_t coefficients_oversampled;    /* of the strings from voice_oversampled up, never shared */
+    sample_t *delays;                 /* the delay lines of the playable strings, back to back, unless shared */
+    resonator_t resonator_left;
+    resonator_t resonator_right;    /* unused without output_pan_spread */
+    coupling_t coupling;
+
+    sample_t busses[N_BUSSES][N_FRAMES_BLOCK];
+    size_t n_busses;                /* in use, the sends past coupling_t.n_sends are not */
+    sample_t buffer_body_left[N_FRAMES_BLOCK];
+    sample_t buffer_body_right[N_FRAMES_BLOCK];
+    sample_t buffer_voice[N_FRAMES_BLOCK];
+    voice_bank_t voice_bank;
+    bool voice_bank_enabled;
+    size_t n_samples_block;         /* shortest string, the longest block for voice_process_block */
+
+    /* the strings from voice_oversampled up run oversample times over, see synth_oversample_set */
+    sample_t busses_oversampled[N_BUSSES][N_FRAMES_BLOCK];
+    sample_t inputs_oversampled[N_PITCH_CLASSES][N_FRAMES_BLOCK];
+    half_band_t half_bands[BUS_SEND][2];    /* a stage per halving, the sends are only averaged */
+    voice_bank_t voice_bank_oversampled;
+    size_t oversample;
+    int voice_oversampled;
+
+    /* the body folded into the plucks instead, see synth_commuted_set */
+    bool commuted;
+    excitations_t *excitations;         /* NULL for none */
+    excitations_t *excitations_fading;  /* swapped out, kept until the plucks under way from it are over */
+    size_t n_frames_fading;
+    excitations_t *excitations_next;    /* posted by the loader, taken up at the next block */
+    excitations_t *excitations_retired; /* waiting to be collected by it */
+
+    /* the strings from voice_modal up run as modes instead, see synth_modal_set */
+    modal_t modals[N_VOICES];
+    int voice_modal;
+    sample_t buffer_excitation[N_FRAMES_BLOCK];
+
+    size_t voices_active[N_VOICES];
+    size_t n_voices_active;
+    double floor_voice;
+    double floor_steal;             /* from TIER_STEAL down */
+    double threshold_sympathetic;
+    int tier;                       /* see synth_tier_set */
+
+    pool_t *pool;                   /* NULL for none, may be shared */
+    size_t n_workers_busy;          /* how many take part in the current block */
+    size_t n_samples_workers;
+
+    uint64_t frame;                 /* frames processed so far */
+    ring_t ring_log;                /* out of the process thread, see synth_log_drain */
+    ring_t ring_control;            /* into it, see synth_post */
+    pthread_mutex_t mutex_post;     /* between posting threads, never taken by the process thread */
+    unsigned long n_messages_dropped;
+    pthread_t logger;
+    bool logger_running;
+
+    telemetry_t telemetry;          /* of the period being processed */
+    double time_period;             /* when it began */
+    ring_t ring_telemetry;          /* out of the process thread, see synth_telemetry_drain */
+    unsigned long n_periods_dropped;
+    unsigned long n_xruns;          /* counted by synth_xrun */
+    unsigned long n_xruns_reported;
+    report_t report;                /* the reporter's own */
+
+    library_t *library;             /* NULL for none, may be shared, see synth_init_shared */
+    bank_t bank;                    /* unused with a library, it has its own */
+    buffer_t impulse_response;      /* of the program loaded last, the library's with one */
+    double rate_impulse_response;
+    long entry;                     /* it came from in the bank, -1 for paths_impulse_response */
+    int program;                    /* asked for by the process thread */
+    int program_loaded;
+    pthread_mutex_t mutex_load;     /* between the loader and synth_rate_set */
+    pthread_t loader;
+    bool loader_running;
+
+    double bend;                    /* frequency ratio, taken up by the strings as they wake too */
+    double damper;                  /* taken up by the strings as they wake */
+    double sustain;
+
+    int voice_min;                  /* the playable strings, see synth_range_set */
+    int voice_max;
+    double volume;
+    bool mix;                       /* adds to the outputs rather than writing them */
+
+    double rate;
+    double delta_time;
+
+} synth_t;
+
+static double synth_clock () {
+
+    struct timespec time;
+    clock_gettime (CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/* seconds since time, which moves on to now */
+static double synth_lap (double *time) {
+
+    double now = synth_clock ();
+    double lap = now - *time;
+
+    *time = now;
+    return lap;
+}
+
+/* the body of a program, from the library if there is one, and which entry it was */
+static bool synth_program_load (synth_t *synth, int program, buffer_t *impulse_response, double *rate) {
+
+    if (synth->library)
+        return library_body (synth->library, program, impulse_response, rate, &synth->entry);
+
+    return body_load (&synth->bank, "", program, impulse_response, rate, &synth->entry);
+}
+
+/* takes over impulse_response from synth_program_load */
+static void synth_impulse_response_set (synth_t *synth, buffer_t *impulse_response, double rate) {
+
+    if (!synth->library)
+        buffer_terminate (&synth->impulse_response);
+    synth->impulse_response = *impulse_response;
+    synth->rate_impulse_response = rate;
+}
+
+/* switches to program right away, before the rate is set */
+void synth_program_set (synth_t *synth, int program) {
+
+    buffer_t impulse_response;
+    double rate;
+
+    if (!synth_program_load (synth, program, &impulse_response, &rate))
+        return;
+
+    synth_impulse_response_set (synth, &impulse_response, rate);
+    synth->program = synth->program_loaded = program;
+}
+
+/* playing patch, with the bodies and coefficient tables of library, which may
+ * be shared with other synths in the process and has to outlive them, or NULL
+ * for its own; the tables of a library are made for its patch, so a synth
+ * playing another takes a table of its own to synth_rate_set_shared, see library_t */
+void synth_init_shared (synth_t *synth, const patch_t *patch, library_t *library) {
+
+    size_t i;
+    size_t j;
+
+    memset (synth, 0, sizeof (synth_t));
+    synth->patch = *patch;
+    synth->library = library;
+
+    for (i = 0; i < N_VOICES; i++) {
+
+        voice_init (&synth->voices[i], i, &synth->patch);
+        voice_seed (&synth->voices[i], rand ());
+    }
+
+    resonator_init (&synth->resonator_left, synth->patch.resonance_body);
+    if (synth->patch.output_pan_spread)
+        resonator_init (&synth->resonator_right, synth->patch.resonance_body);
+    coupling_init (&synth->coupling, &synth->patch);
+    synth->n_busses = BUS_SEND + synth->coupling.n_sends;
+    for (i = 0; i < BUS_SEND; i++)
+        for (j = 0; j < 2; j++)
+            half_band_init (&synth->half_bands[i][j]);
+    for (i = 0; i < N_VOICES; i++)
+        modal_init (&synth->modals[i]);
+
+    /* the kernels wait for the rate, without a body until a program change brings one */
+    if (!library)
+        bank_open (&synth->bank, PATH_BANK);
+    if (!synth_program_load (synth, 0, &synth->impulse_response, &synth->rate_impulse_response))
+        fputs ("no body for da strings 😢 playing them dry\n", stderr);
+    pthread_mutex_init (&synth->mutex_load, NULL);
+
+    ring_init (&synth->ring_log, N_MESSAGES_LOG, sizeof (message_t));
+    ring_init (&synth->ring_telemetry, N_PERIODS_TELEMETRY, sizeof (telemetry_t));
+    ring_init (&synth->ring_control, N_MESSAGES_CONTROL, sizeof (message_t));
+    pthread_mutex_init (&synth->mutex_post, NULL);
+
+    synth->voice_bank_enabled = VOICE_BANK;
+    synth->voice_min = synth->patch.voice_min;
+    synth->voice_max = synth->patch.voice_max;
+    synth->oversample = OVERSAMPLE;
+    synth->voice_oversampled = OVERSAMPLE_VOICE_MIN;
+    synth->commuted = COMMUTED;
+    synth->voice_modal = MODAL_VOICE_MIN;
+    synth->volume = synth->patch.volume;
+    synth->floor_voice = decibels_to_amplitude (VOICE_FLOOR);
+    synth->floor_steal = decibels_to_amplitude (GOVERNOR_FLOOR);
+    synth->threshold_sympathetic = decibels_to_amplitude (VOICE_THRESHOLD_SYMPATHETIC);
+    synth->bend = 1;
+    synth->sustain = 1;
+}
+
+/* playing the patch at PATH_PATCH */
+void synth_init (synth_t *synth) {
+
+    patch_t patch;
+
+    patch_load (&patch, PATH_PATCH);
+    synth_init_shared (synth, &patch, NULL);
+}
+
+void synth_terminate (synth_t *synth) {
+
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < N_VOICES; i++) {
+
+        voice_terminate (&synth->voices[i]);
+        modal_terminate (&synth->modals[i]);
+    }
+    for (i = 0; i < BUS_SEND; i++)
+        for (j = 0; j < 2; j++)
+            half_band_terminate (&synth->half_bands[i][j]);
+
+    free (synth->delays);
+    excitations_destroy (synth->excitations);
+    excitations_destroy (synth->excitations_fading);
+    excitations_destroy (synth->excitations_next);
+    excitations_destroy (synth->excitations_retired);
+    resonator_terminate (&synth->resonator_left);
+    if (synth->patch.output_pan_spread)
+        resonator_terminate (&synth->resonator_right);
+    coupling_terminate (&synth->coupling);
+
+    ring_terminate (&synth->ring_log);
+    ring_terminate (&synth->ring_telemetry);
+    ring_terminate (&synth->ring_control);
+    pthread_mutex_destroy (&synth->mutex_post);
+
+    if (!synth->library)
+        buffer_terminate (&synth->impulse_response);
+    pthread_mutex_destroy (&synth->mutex_load);
+    bank_close (&synth->bank);
+}
+
+/* the impulse response resampled to rate into body, or a lone unit
+ * impulse leaving the strings dry while there is none */
+static void synth_body_resample (synth_t *synth, buffer_t *body, double rate) {
+
+    if (!synth->impulse_response.n_samples) {
+
+        buffer_init (body, 1, calloc (1, sizeof (sample_t)));
+        body->data[0] = 1;
+        return;
+    }
+
+    buffer_resample (body, &synth->impulse_response, rate / synth->rate_impulse_response);
+}
+
+/* the impulse response resampled and partitioned for one resonator,
+ * made once for all the synths sharing a library */
+static kernel_t *synth_kernel_create (synth_t *synth) {
+
+    if (!synth->impulse_response.n_samples) {
+
+        buffer_t body;
+        kernel_t *kernel;
+
+        synth_body_resample (synth, &body, synth->rate);
+        kernel = kernel_create (&body);
+        buffer_terminate (&body);
+        return kernel;
+    }
+
+    if (synth->library)
+        return library_kernel (synth->library, &synth->impulse_response, synth->rate);
+
+    return body_kernel (&synth->bank, synth->entry, &synth->impulse_response, synth->rate_impulse_response, synth->rate);
+}
+
+/* the plucks of the playable strings through the body at the rate, and at
+ * the rate of the oversampled ones for them */
+static excitations_t *synth_excitations_create (synth_t *synth) {
+
+    int i;
+    buffer_t body;
+    excitations_t *excitations = calloc (1, sizeof (excitations_t));
+
+    synth_body_resample (synth, &body, synth->rate);
+    excitations_pluck (excitations->plucks, synth->voices, synth->voice_min, synth->voice_max, &body, synth->rate);
+    buffer_terminate (&body);
+
+    if (synth->oversample > 1 && synth->voice_oversampled < synth->voice_max) {
+
+        synth_body_resample (synth, &body, synth->rate * synth->oversample);
+        excitations_pluck (excitations->plucks_oversampled, synth->voices,
+                           synth->voice_oversampled > synth->voice_min ? synth->voice_oversampled : synth->voice_min,
+                           synth->voice_max, &body, synth->rate * synth->oversample);
+        buffer_terminate (&body);
+    }
+
+    for (i = 0; i < N_VOICES; i++) {
+
+        if (excitations->n_frames < excitations->plucks[i].n_samples)
+            excitations->n_frames = excitations->plucks[i].n_samples;
+        if (excitations->n_frames < excitations->plucks_oversampled[i].n_samples / synth->oversample + 1)
+            excitations->n_frames = excitations->plucks_oversampled[i].n_samples / synth->oversample + 1;
+    }
+
+    return excitations;
+}
+
+/* swaps right away, never while processing; takes over the excitations */
+static void synth_excitations_set (synth_t *synth, excitations_t *excitations) {
+
+    excitations_destroy (synth->excitations);
+    excitations_destroy (synth->excitations_fading);
+    excitations_destroy (synth->excitations_next);
+    excitations_destroy (synth->excitations_retired);
+    synth->excitations = excitations;
+    synth->excitations_fading = NULL;
+    synth->excitations_next = NULL;
+    synth->excitations_retired = NULL;
+}
+
+/* takes up excitations posted by the loader, keeping the last ones around
+ * until every pluck under way from them is over; between blocks of n_samples */
+static void synth_excitations_swap (synth_t *synth, size_t n_samples) {
+
+    if (synth->excitations_fading) {
+
+        /* keeps them while the last ones are still uncollected */
+        excitations_t *expected = NULL;
+        synth->n_frames_fading = synth->n_frames_fading > n_samples ? synth->n_frames_fading - n_samples : 0;
+        if (!synth->n_frames_fading
+            && __atomic_compare_exchange_n (&synth->excitations_retired, &expected, synth->excitations_fading,
+                                            false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            synth->excitations_fading = NULL;
+    }
+
+    if (!synth->excitations_fading && __atomic_load_n (&synth->excitations_next, __ATOMIC_RELAXED)) {
+
+        synth->excitations_fading = synth->excitations;
+        synth->excitations = __atomic_exchange_n (&synth->excitations_next, NULL, __ATOMIC_ACQUIRE);
+        synth->n_frames_fading = synth->excitations_fading ? synth->excitations_fading->n_frames : 0;
+    }
+}
+
+/* how many times over string i runs, the modal ones never */
+static size_t synth_voice_oversample (synth_t *synth, int i) {
+
+    return i >= synth->voice_oversampled && i < synth->voice_modal ? synth->oversample : 1;
+}
+
+/* every playable string gets a delay line just long enough for its lowest
+ * reachable pitch at rate, the others none at all; this many samples of them */
+size_t synth_delays_n_samples (synth_t *synth, double rate) {
+
+    int i;
+    size_t n_samples = 0;
+    size_t n_samples_line = SIZE_CACHE_LINE / sizeof (sample_t);
+
+    for (i = synth->voice_min; i < synth->voice_max; i++)
+        n_samples += (voice_n_samples_max (&synth->voices[i], rate * synth_voice_oversample (synth, i))
+                      + n_samples_line - 1) / n_samples_line * n_samples_line;
+
+    return n_samples;
+}
+
+/* lays the delay lines out over delays, aligned to SIZE_CACHE_LINE */
+static void synth_delays_place (synth_t *synth, sample_t *delays) {
+
+    int i;
+    size_t n_samples_line = SIZE_CACHE_LINE / sizeof (sample_t);
+
+    memset (delays, 0, synth_delays_n_samples (synth, synth->rate) * sizeof (sample_t));
+
+    for (i = synth->voice_min; i < synth->voice_max; i++) {
+
+        size_t n = voice_n_samples_max (&synth->voices[i], synth->rate * synth_voice_oversample (synth, i));
+        voice_buffer_set (&synth->voices[i], delays, n);
+        delays += (n + n_samples_line - 1) / n_samples_line * n_samples_line;
+    }
+}
+
+/* the playable strings, from voice_min up to but not including voice_max,
+ * before the rate is set */
+void synth_range_set (synth_t *synth, int voice_min, int voice_max) {
+
+    int i;
+
+    synth->voice_min = voice_min < 0 ? 0 : voice_min;
+    synth->voice_max = voice_max > N_VOICES ? N_VOICES : voice_max;
+    if (synth->voice_max < synth->voice_min)
+        synth->voice_max = synth->voice_min;
+
+    for (i = 0; i < N_VOICES; i++)
+        voice_position_set (&synth->voices[i], i, synth->voice_min, synth->voice_max);
+}
+
+/* runs the strings from voice_min up oversample times over, 2 or 4, or none
+ * at all with 1, before the rate is set; the short ones high up gain the most */
+void synth_oversample_set (synth_t *synth, size_t oversample, int voice_min) {
+
+    synth->oversample = oversample == 2 || oversample == 4 ? oversample : 1;
+    synth->voice_oversampled = voice_min;
+}
+
+/* runs the strings from voice_min up as banks of modes rather than waveguides,
+ * N_VOICES for none, before the rate is set; they keep their lines for the
+ * plucks to be measured against, but no longer limit the block */
+void synth_modal_set (synth_t *synth, int voice_min) {
+
+    synth->voice_modal = voice_min;
+}
+
+/* folds the body into the plucks rather than running it after the strings,
+ * before the rate is set; the strings then hear each other through the body,
+ * and the dry outputs and stems have it too */
+void synth_commuted_set (synth_t *synth, bool commuted) {
+
+    synth->commuted = commuted;
+}
+
+/* sets the rate with a coefficient table made for its patch and delay lines,
+ * either of which may be shared with other synths; delays holds
+ * synth_delays_n_samples at rate, cache aligned */
+void synth_rate_set_shared (synth_t *synth, double rate, const coefficients_t *coefficients, sample_t *delays) {
+
+    int i;
+    size_t j;
+
+    pthread_mutex_lock (&synth->mutex_load);
+
+    synth->rate = rate;
+    synth->delta_time = 1.0 / rate;
+    synth->coefficients_rate = coefficients;
+
+    /* the oversampled busses hold a block at the higher rate */
+    synth->n_samples_block = synth->voice_oversampled < synth->voice_max
+                             && synth->voice_oversampled < synth->voice_modal
+                           ? N_FRAMES_BLOCK / synth->oversample
+                           : N_FRAMES_BLOCK;
+
+    if (synth->oversample > 1)
+        coefficients_init (&synth->coefficients_oversampled, &synth->patch, rate * synth->oversample);
+    for (i = 0; i < N_VOICES; i++)
+        voice_rate_set (&synth->voices[i], synth_voice_oversample (synth, i) > 1
+                                           ? &synth->coefficients_oversampled
+                                           : coefficients);
+    for (j = 0; j < BUS_SEND; j++) {
+
+        half_band_init (&synth->half_bands[j][0]);
+        half_band_init (&synth->half_bands[j][1]);
+    }
+
+    synth_delays_place (synth, delays);
+    for (i = 0; i < N_VOICES; i++)
+        modal_init (&synth->modals[i]);
+
+    /* the string may be bent up to its shortest, and the governor may wake
+     * an oversampled one at the rate */
+    for (i = synth->voice_min; i < synth->voice_max && i < synth->voice_modal; i++) {
+
+        size_t oversample = synth_voice_oversample (synth, i);
+        double length = synth->voices[i].length_target / pow (2, synth->patch.bend_range / 12.0);
+        size_t n_samples = delay_length_whole (length) / oversample;
+
+        if (oversample > 1 && delay_length_whole (length / oversample) < n_samples)
+            n_samples = delay_length_whole (length / oversample);
+        if (n_samples < synth->n_samples_block)
+            synth->n_samples_block = n_samples;
+    }
+
+    if (synth->commuted) {
+
+        synth_excitations_set (synth, synth_excitations_create (synth));
+
+    } else if (synth->patch.resonance_body) {
+
+        convolver_kernel_set (&synth->resonator_left.convolver, synth_kernel_create (synth));
+        if (synth->patch.output_pan_spread)
+            convolver_kernel_set (&synth->resonator_right.convolver, synth_kernel_create (synth));
+    }
+
+    pthread_mutex_unlock (&synth->mutex_load);
+}
+
+/* allocates delay lines of its own, and a coefficient table unless its library has them */
+void synth_rate_set (synth_t *synth, double rate) {
+
+    size_t n_samples = synth_delays_n_samples (synth, rate);
+    const coefficients_t *coefficients = &synth->coefficients;
+
+    if (synth->library)
+        coefficients = library_coefficients (synth->library, rate);
+    else
+        coefficients_init (&synth->coefficients, &synth->patch, rate);
+
+    free (synth->delays);
+    if (posix_memalign ((void **) &synth->delays, SIZE_CACHE_LINE, n_samples * sizeof (sample_t))) {
+
+        fputs ("no memory for da strings 😭\n", stderr);
+        exit (EXIT_FAILURE);
+    }
+
+    synth_rate_set_shared (synth, rate, coefficients, synth->delays);
+}
+
+/* gives up the quality of every tier up to tier, or takes back that of those
+ * after it, see governor_t; from the process thread between periods */
+void synth_tier_set (synth_t *synth, int tier) {
+
+    size_t n_partitions = tier >= TIER_BODY ? GOVERNOR_N_PARTITIONS : CONVOLVER_N_PARTITIONS_ALL;
+
+    synth->tier = tier;
+    convolver_partitions_limit (&synth->resonator_left.convolver, n_partitions);
+    if (synth->patch.output_pan_spread)
+        convolver_partitions_limit (&synth->resonator_right.convolver, n_partitions);
+}
+
+static void synth_voice_activate (synth_t *synth, size_t i_voice, double level) {
+
+    if ((int) i_voice < synth->voice_min || (int) i_voice >= synth->voice_max)
+        return;
+
+    if (!synth->voices[i_voice].active) {
+
+        /* a silent string can change rate, its line is long enough for either */
+        if (synth_voice_oversample (synth, i_voice) > 1)
+            voice_rate_set (&synth->voices[i_voice], synth->tier < TIER_OVERSAMPLE
+                                                     ? &synth->coefficients_oversampled
+                                                     : synth->coefficients_rate);
+        synth->voices_active[synth->n_voices_active++] = i_voice;
+        voice_bend_set (&synth->voices[i_voice], synth->bend);
+        voice_damper_set (&synth->voices[i_voice], synth->damper);
+        voice_sustain_set (&synth->voices[i_voice], synth->sustain);
+    }
+
+    voice_activate (&synth->voices[i_voice], level);
+}
+
+/* wakes the idle strings hearing the others loudly enough to ring along:
+ * what a string hears counts as much as its partials line up with those of
+ * a string whose own send alone would be heard above the threshold, so that
+ * unrelated strings stay asleep and strings only woken wake no others */
+static void synth_voices_activate_sympathetic (synth_t *synth) {
+
+    size_t i;
+    size_t j;
+    double affinities[N_PITCH_CLASSES] = { 0 };
+
+    if ((int) synth->n_voices_active == synth->voice_max - synth->voice_min)
+        return;
+
+    for (i = 0; i < synth->n_voices_active; i++) {
+
+        voice_t *voice = &synth->voices[synth->voices_active[i]];
+
+        if (voice->admittance * voice->peak_period * synth->patch.sympathetic_resonance / N_VOICES
+            > synth->threshold_sympathetic)
+            for (j = 0; j < N_PITCH_CLASSES; j++) {
+
+                double affinity = coupling_affinity[(j + N_PITCH_CLASSES - voice->note % N_PITCH_CLASSES)
+                                                    % N_PITCH_CLASSES];
+                if (affinity > affinities[j])
+                    affinities[j] = affinity;
+            }
+    }
+
+    for (i = synth->voice_min; (int) i < synth->voice_max; i++) {
+
+        double peak;
+
+        if (synth->voices[i].active)
+            continue;
+
+        peak = affinities[i % N_PITCH_CLASSES] * coupling_peak (&synth->coupling, &synth->voices[i]);
+        if (peak > synth->threshold_sympathetic)
+            synth_voice_activate (synth, i, peak);
+    }
+}
+
+static void synth_voices_retire (synth_t *synth) {
+
+    size_t i;
+    size_t n = 0;
+    double floor = synth->tier >= TIER_STEAL ? synth->floor_steal : synth->floor_voice;
+
+    for (i = 0; i < synth->n_voices_active; i++) {
+
+        voice_t *voice = &synth->voices[synth->voices_active[i]];
+
+        if (voice_idle (voice, floor))
+            voice_deactivate (voice);
+        else
+            synth->voices_active[n++] = synth->voices_active[i];
+    }
+
+    synth->n_voices_active = n;
+}
+
+static void synth_busses_clear (synth_t *synth, sample_t (*busses)[N_FRAMES_BLOCK], size_t n_samples) {
+
+    size_t i;
+
+    for (i = 0; i < synth->n_busses; i++)
+        memset (busses[i], 0, sizeof (sample_t) * n_samples);
+}
+
+/* runs the strings of i_voices, mixing them into busses;
+ * without a voice bank they are run one by one through buffer_voice */
+static void synth_strings_process (synth_t *synth,
+                                   voice_bank_t *bank,
+                                   sample_t (*busses)[N_FRAMES_BLOCK],
+                                   sample_t *buffer_voice,
+                                   size_t *i_voices,
+                                   size_t n_voices,
+                                   size_t n_samples) {
+
+    size_t i;
+
+    for (i = 0; i < n_voices; i++)
+        voice_excite_block (&synth->voices[i_voices[i]], n_samples);
+
+    if (bank && synth->voice_bank_enabled) {
+
+        voice_bank_load (bank, synth->voices, i_voices, n_voices);
+        voice_bank_process_block (bank, busses, synth->coupling.n_sends, n_samples);
+        return;
+    }
+
+    for (i = 0; i < n_voices; i++) {
+
+        voice_t *voice = &synth->voices[i_voices[i]];
+
+        voice_process_block (voice, buffer_voice, n_samples);
+        voice_mix_block (voice, buffer_voice, busses, synth->coupling.n_sends, n_samples);
+    }
+}
+
+/* feeds inputs, the sympathetic ones of coupling_t or the same oversampled,
+ * to the strings run by synth_strings_process */
+static void synth_strings_input (synth_t *synth,
+                                 voice_bank_t *bank,
+                                 sample_t (*inputs)[N_FRAMES_BLOCK],
+                                 size_t *i_voices,
+                                 size_t n_voices,
+                                 size_t n_samples) {
+
+    size_t i;
+
+    if (bank && synth->voice_bank_enabled) {
+
+        voice_bank_input_block (bank, inputs, synth->coupling.n_inputs, n_samples);
+        voice_bank_store (bank);
+        return;
+    }
+
+    for (i = 0; i < n_voices; i++) {
+
+        voice_t *voice = &synth->voices[i_voices[i]];
+        voice_input_block (voice, coupling_input (&synth->coupling, inputs, voice), n_samples);
+    }
+}
+
+/* orders i_voices with the strings run at the rate first, the oversampled ones
+ * after them and the modal ones last, returning how many run at the rate and
+ * leaving how many are oversampled in n_oversampled */
+static size_t synth_voices_partition (synth_t *synth, size_t *i_voices, size_t n_voices, size_t *n_oversampled) {
+
+    size_t i;
+    size_t n = 0;
+    size_t n_modal = 0;
+    size_t oversampled[N_VOICES];
+    size_t modal[N_VOICES];
+
+    *n_oversampled = 0;
+    if (synth->oversample == 1 && synth->voice_modal >= synth->voice_max)
+        return n_voices;
+
+    for (i = 0; i < n_voices; i++) {
+
+        if ((int) i_voices[i] >= synth->voice_modal)
+            modal[n_modal++] = i_voices[i];
+        else if (synth->voices[i_voices[i]].rate > synth->rate)
+            oversampled[(*n_oversampled)++] = i_voices[i];
+        else
+            i_voices[n++] = i_voices[i];
+    }
+
+    memcpy (i_voices + n, oversampled, sizeof (size_t) * *n_oversampled);
+    memcpy (i_voices + n + *n_oversampled, modal, sizeof (size_t) * n_modal);
+    return n;
+}
+
+/* runs the modal strings of i_voices, mixing them into the busses */
+static void synth_modal_process (synth_t *synth, size_t *i_voices, size_t n_voices, size_t n_samples) {
+
+    size_t i;
+
+    for (i = 0; i < n_voices; i++) {
+
+        voice_t *voice = &synth->voices[i_voices[i]];
+
+        voice_excite_buffer (voice, synth->buffer_excitation, n_samples);
+        modal_process_block (&synth->modals[i_voices[i]], voice, synth->buffer_excitation, synth->buffer_voice, n_samples);
+        voice_mix_block (voice, synth->buffer_voice, synth->busses, synth->coupling.n_sends, n_samples);
+    }
+}
+
+/* feeds them the sympathetic inputs of coupling_t */
+static void synth_modal_input (synth_t *synth, size_t *i_voices, size_t n_voices, size_t n_samples) {
+
+    size_t i;
+
+    for (i = 0; i < n_voices; i++) {
+
+        voice_t *voice = &synth->voices[i_voices[i]];
+        modal_input_block (&synth->modals[i_voices[i]], voice,
+                           coupling_input (&synth->coupling, synth->coupling.inputs, voice), n_samples);
+    }
+}
+
+/* brings n_samples of the oversampled dry busses and stems down to the rate,
+ * adding them to the busses */
+static void synth_busses_decimate (synth_t *synth, size_t n_samples) {
+
+    size_t i;
+
+    for (i = 0; i < BUS_SEND; i++) {
+
+        size_t j;
+        size_t k;
+        size_t n = n_samples * synth->oversample;
+        sample_t *bus = synth->busses_oversampled[i];
+
+        for (k = 0; n > n_samples; k++) {
+
+            n /= 2;
+            half_band_process (&synth->half_bands[i][k], bus, bus, n);
+        }
+
+        for (j = 0; j < n_samples; j++)
+            synth->busses[i][j] += bus[j];
+    }
+}
+
+/* the same for the sends by averaging, since the strings only hear them through
+ * the bridge filters; the half-band filters would be late enough to turn the
+ * strings driving themselves through the bridge out of phase */
+static void synth_sends_decimate (synth_t *synth, size_t n_samples) {
+
+    size_t i;
+
+    for (i = BUS_SEND; i < synth->n_busses; i++) {
+
+        size_t j;
+        sample_t *bus = synth->busses_oversampled[i];
+
+        for (j = 0; j < n_samples; j++) {
+
+            size_t k;
+            state_t sum = 0;
+
+            for (k = 0; k < synth->oversample; k++)
+                sum += bus[j * synth->oversample + k];
+            synth->busses[i][j] += sum / synth->oversample;
+        }
+    }
+}
+
+/* holds each of n_samples of the sympathetic inputs for oversample samples,
+ * the bridge filter of the strings smoothing the steps */
+static void synth_inputs_oversample (synth_t *synth, size_t n_samples) {
+
+    size_t i;
+
+    for (i = 0; i < synth->coupling.n_inputs; i++) {
+
+        size_t j;
+        for (j = 0; j < n_samples * synth->oversample; j++)
+            synth->inputs_oversampled[i][j] = synth->coupling.inputs[i][j / synth->oversample];
+    }
+}
+
+/* waits are a handful of microseconds on dedicated cores,
+ * yield now and then in case the cores are shared after all */
+static void worker_spin (unsigned int *n_spins) {
+
+    if (!(++*n_spins % WORKER_N_SPINS_YIELD))
+        sched_yield ();
+}
+
+static void synth_workers_wait (synth_t *synth) {
+
+    unsigned int n_spins = 0;
+
+    while (__atomic_load_n (&synth->pool->n_workers_done, __ATOMIC_ACQUIRE) < synth->n_workers_busy)
+        worker_spin (&n_spins);
+}
+
+static void *worker_run (void *arg) {
+
+    worker_t *worker = arg;
+    pool_t *pool = worker->pool;
+
+    for (;;) {
+
+        unsigned int generation;
+        unsigned int n_spins = 0;
+        synth_t *synth;
+        size_t *i_voices;
+        size_t n;
+
+        sem_wait (&worker->semaphore);
+        if (!__atomic_load_n (&pool->running, __ATOMIC_ACQUIRE))
+            break;
+
+        synth = worker->synth;
+        generation = __atomic_load_n (&pool->generation, __ATOMIC_ACQUIRE);
+        i_voices = synth->voices_active + worker->i_voice_first;
+        n = synth->n_samples_workers;
+
+        synth_busses_clear (synth, worker->busses, n);
+        synth_strings_process (synth, &worker->voice_bank, worker->busses, worker->buffer_voice,
+                               i_voices, worker->n_voices, n);
+        __atomic_add_fetch (&pool->n_workers_done, 1, __ATOMIC_RELEASE);
+
+        /* barrier: the process thread sums every slice into the sympathetic input */
+        while (__atomic_load_n (&pool->generation, __ATOMIC_ACQUIRE) == generation)
+            worker_spin (&n_spins);
+
+        synth_strings_input (synth, &worker->voice_bank, synth->coupling.inputs, i_voices, worker->n_voices, n);
+        __atomic_add_fetch (&pool->n_workers_done, 1, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+/* the core after core the process may run on, -1 for none */
+static int pool_core_next (const cpu_set_t *cores, int core) {
+
+    while (++core < CPU_SETSIZE)
+        if (CPU_ISSET (core, cores))
+            return core;
+
+    return -1;
+}
+
+/* starts n_workers threads, each pinned to its own core other than the
+ * first the process may run on, at realtime priority if we are allowed to;
+ * fewer if they cannot all be started */
+void pool_start (pool_t *pool, size_t n_workers) {
+
+    size_t i;
+    cpu_set_t allowed;
+    bool pinned = !sched_getaffinity (0, sizeof (cpu_set_t), &allowed);
+    long n_cores = pinned ? CPU_COUNT (&allowed) : sysconf (_SC_NPROCESSORS_ONLN);
+    int core = pinned ? pool_core_next (&allowed, -1) : -1;
+
+    /* spinning workers must never share a core with each other or the process thread */
+    if (n_cores < 2)
+        n_workers = 0;
+    else if (n_workers > (size_t) n_cores - 1)
+        n_workers = n_cores - 1;
+
+    memset (pool, 0, sizeof (pool_t));
+    pool->workers = calloc (n_workers, sizeof (worker_t));
+    pool->n_workers = n_workers;
+    pool->running = true;
+
+    for (i = 0; i < n_workers; i++) {
+
+        worker_t *worker = &pool->workers[i];
+        pthread_attr_t attributes;
+        struct sched_param parameters;
+        cpu_set_t cores;
+
+        worker->pool = pool;
+        sem_init (&worker->semaphore, 0, 0);
+
+        pthread_attr_init (&attributes);
+        pthread_attr_setinheritsched (&attributes, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy (&attributes, SCHED_FIFO);
+        parameters.sched_priority = WORKER_PRIORITY;
+        pthread_attr_setschedparam (&attributes, &parameters);
+
+        if (pthread_create (&worker->thread, &attributes, worker_run, worker)) {
+
+            fputs ("no realtime for da workers 😢 running them normally\n", stderr);
+            if (pthread_create (&worker->thread, NULL, worker_run, worker)) {
+
+                fprintf (stderr, "cldnt start da workers 😭 running %lu of them\n", (unsigned long) i);
+                sem_destroy (&worker->semaphore);
+                pthread_attr_destroy (&attributes);
+                pool->n_workers = i;
+                return;
+            }
+        }
+        pthread_attr_destroy (&attributes);
+
+        /* left wherever the scheduler puts them if the cores cannot be told */
+        if (!pinned)
+            continue;
+
+        core = pool_core_next (&allowed, core);
+        CPU_ZERO (&cores);
+        CPU_SET (core, &cores);
+        if (pthread_setaffinity_np (worker->thread, sizeof (cpu_set_t), &cores)) {
+
+            fputs ("cldnt pin da workers to their cores 😢 letting them roam\n", stderr);
+            pinned = false;
+        }
+    }
+}
+
+void pool_stop (pool_t *pool) {
+
+    size_t i;
+
+    __atomic_store_n (&pool->running, false, __ATOMIC_RELEASE);
+
+    for (i = 0; i < pool->n_workers; i++) {
+
+        sem_post (&pool->workers[i].semaphore);
+        pthread_join (pool->workers[i].thread, NULL);
+        sem_destroy (&pool->workers[i].semaphore);
+    }
+
+    free (pool->workers);
+    pool->workers = NULL;
+    pool->n_workers = 0;
+}
+
+/* hands the first n_voices active strings out to the workers and waits for their outputs */
+static void synth_workers_process (synth_t *synth, size_t n_voices, size_t n_samples) {
+
+    size_t i;
+    size_t i_voice = 0;
+    size_t n_groups = (n_voices + N_LANES - 1) / N_LANES;
+    pool_t *pool = synth->pool;
+
+    synth->n_workers_busy = n_voices / WORKER_N_VOICES_MIN;
+    if (synth->n_workers_busy > pool->n_workers)
+        synth->n_workers_busy = pool->n_workers;
+    if (!synth->n_workers_busy)
+        return;
+
+    synth->n_samples_workers = n_samples;
+    __atomic_store_n (&pool->n_workers_done, 0, __ATOMIC_RELAXED);
+
+    /* whole lane groups each */
+    for (i = 0; i < synth->n_workers_busy; i++) {
+
+        worker_t *worker = &pool->workers[i];
+        size_t n = (n_groups * (i + 1) / synth->n_workers_busy) * N_LANES;
+        if (n > n_voices)
+            n = n_voices;
+
+        worker->synth = synth;
+        worker->i_voice_first = i_voice;
+        worker->n_voices = n - i_voice;
+        i_voice = n;
+        sem_post (&worker->semaphore);
+    }
+
+    synth_workers_wait (synth);
+
+    for (i = 0; i < synth->n_workers_busy; i++) {
+
+        size_t j;
+        size_t k;
+        worker_t *worker = &pool->workers[i];
+
+        for (k = 0; k < synth->n_busses; k++)
+            for (j = 0; j < n_samples; j++)
+                synth->busses[k][j] += worker->busses[k][j];
+    }
+}
+
+static void synth_output (synth_t *synth, jack_default_audio_sample_t **output, const sample_t *bus, size_t n_samples) {
+
+    size_t i;
+
+    if (!*output)
+        return;
+
+    if (synth->mix)
+        for (i = 0; i < n_samples; i++)
+            (*output)[i] += synth->volume * bus[i];
+    else
+        for (i = 0; i < n_samples; i++)
+            (*output)[i] = synth->volume * bus[i];
+    *output += n_samples;
+}
+
+/* writes n_frames to each of the N_OUTPUTS outputs that is not NULL,
+ * advancing them past what was written */
+void synth_process_audio (synth_t *synth,
+                          jack_nframes_t n_frames,
+                          jack_default_audio_sample_t **outputs) {
+
+    while (n_frames) {
+
+        size_t i;
+        size_t n_voices_active = synth->n_voices_active;
+        size_t n_voices_rate;           /* of them, the oversampled then the modal ones follow */
+        size_t n_voices_oversampled;
+        size_t n_voices_modal;
+        size_t n_voices_woken;
+        size_t n_voices_woken_rate;
+        size_t n_voices_woken_oversampled;
+        size_t n_voices_woken_modal;
+        bool oversampled;
+        double time = TELEMETRY ? synth_clock () : 0;
+        size_t n = n_frames < synth->n_samples_block ? n_frames : synth->n_samples_block;
+        size_t n_oversampled = n * synth->oversample;
+
+        /* TODO
+         * learn abt coupling between transverse planes n longitudinal 
+         * due to the bridge ?????? */
+
+        if (synth->commuted)
+            synth_excitations_swap (synth, n);
+
+        /* length changes */
+        if (synth->n_voices_active) {
+
+            double share = 1 - exp (-(double) n / (synth->rate * synth->patch.time_glide));
+            for (i = 0; i < synth->n_voices_active; i++)
+                voice_glide (&synth->voices[synth->voices_active[i]], share);
+        }
+
+        /* strings, the oversampled and modal ones on the process thread only */
+        n_voices_rate = synth_voices_partition (synth, synth->voices_active, n_voices_active, &n_voices_oversampled);
+        n_voices_modal = n_voices_active - n_voices_rate - n_voices_oversampled;
+        synth_busses_clear (synth, synth->busses, n);
+        if (synth->oversample > 1)
+            synth_busses_clear (synth, synth->busses_oversampled, n_oversampled);
+        synth->n_workers_busy = 0;
+        if (synth->pool)
+            synth_workers_process (synth, n_voices_rate, n);
+        if (!synth->n_workers_busy)
+            synth_strings_process (synth, &synth->voice_bank, synth->busses, synth->buffer_voice,
+                                   synth->voices_active, n_voices_rate, n);
+        if (n_voices_oversampled) {
+
+            synth_strings_process (synth, &synth->voice_bank_oversampled, synth->busses_oversampled,
+                                   synth->buffer_voice, synth->voices_active + n_voices_rate,
+                                   n_voices_oversampled, n_oversampled);
+            synth_sends_decimate (synth, n);
+        }
+        synth_modal_process (synth, synth->voices_active + n_voices_active - n_voices_modal, n_voices_modal, n);
+
+        /* every string hears the others through the bridge one sample later */
+        coupling_process (&synth->coupling, synth->busses + BUS_SEND, n);
+
+        /* strings woken up by it still need to be run for this block,
+         * what they give the bridge until its end goes unheard */
+        if (synth->tier < TIER_SYMPATHETIC)
+            synth_voices_activate_sympathetic (synth);
+        n_voices_woken = synth->n_voices_active - n_voices_active;
+        n_voices_woken_rate = synth_voices_partition (synth, synth->voices_active + n_voices_active, n_voices_woken,
+                                                      &n_voices_woken_oversampled);
+        n_voices_woken_modal = n_voices_woken - n_voices_woken_rate - n_voices_woken_oversampled;
+        synth_strings_process (synth, NULL, synth->busses, synth->buffer_voice,
+                               synth->voices_active + n_voices_active, n_voices_woken_rate, n);
+        synth_strings_process (synth, NULL, synth->busses_oversampled, synth->buffer_voice,
+                               synth->voices_active + n_voices_active + n_voices_woken_rate,
+                               n_voices_woken_oversampled, n_oversampled);
+        synth_modal_process (synth, synth->voices_active + synth->n_voices_active - n_voices_woken_modal,
+                             n_voices_woken_modal, n);
+
+        oversampled = n_voices_oversampled || n_voices_woken_oversampled;
+        if (oversampled)
+            synth_inputs_oversample (synth, n);
+
+        if (synth->n_workers_busy) {
+
+            __atomic_store_n (&synth->pool->n_workers_done, 0, __ATOMIC_RELAXED);
+            __atomic_add_fetch (&synth->pool->generation, 1, __ATOMIC_RELEASE);
+
+        } else {
+
+            synth_strings_input (synth, &synth->voice_bank, synth->coupling.inputs,
+                                 synth->voices_active, n_voices_rate, n);
+        }
+        if (n_voices_oversampled)
+            synth_strings_input (synth, &synth->voice_bank_oversampled, synth->inputs_oversampled,
+                                 synth->voices_active + n_voices_rate, n_voices_oversampled, n_oversampled);
+        synth_modal_input (synth, synth->voices_active + n_voices_active - n_voices_modal, n_voices_modal, n);
+        synth_strings_input (synth, NULL, synth->coupling.inputs,
+                             synth->voices_active + n_voices_active, n_voices_woken_rate, n);
+        synth_strings_input (synth, NULL, synth->inputs_oversampled,
+                             synth->voices_active + n_voices_active + n_voices_woken_rate,
+                             n_voices_woken_oversampled, n_oversampled);
+        synth_modal_input (synth, synth->voices_active + synth->n_voices_active - n_voices_woken_modal,
+                           n_voices_woken_modal, n);
+
+        /* the dry strings and the stems of the oversampled ones join the others before the body */
+        if (oversampled)
+            synth_busses_decimate (synth, n);
+
+        if (TELEMETRY) {
+
+            synth->telemetry.time_strings += synth_lap (&time);
+            if (synth->telemetry.n_voices_max < synth->n_voices_active)
+                synth->telemetry.n_voices_max = synth->n_voices_active;
+        }
+
+        /* a centred mix needs only the one body, and commuted plucks none at all */
+        if (!synth->commuted) {
+
+            resonator_process_block (&synth->resonator_left, synth->busses[BUS_LEFT], synth->buffer_body_left, n);
+            if (synth->patch.output_pan_spread)
+                resonator_process_block (&synth->resonator_right, synth->busses[BUS_RIGHT], synth->buffer_body_right, n);
+        }
+
+        synth_output (synth, &outputs[OUTPUT_LEFT],
+                      synth->commuted ? synth->busses[BUS_LEFT] : synth->buffer_body_left, n);
+        synth_output (synth, &outputs[OUTPUT_RIGHT],
+                      synth->commuted ? synth->busses[BUS_RIGHT]
+                                      : synth->patch.output_pan_spread ? synth->buffer_body_right : synth->buffer_body_left, n);
+        synth_output (synth, &outputs[OUTPUT_DRY_LEFT], synth->busses[BUS_LEFT], n);
+        synth_output (synth, &outputs[OUTPUT_DRY_RIGHT], synth->busses[BUS_RIGHT], n);
+        for (i = 0; i < OUTPUT_N_STEMS; i++)
+            synth_output (synth, &outputs[OUTPUT_STEM + i], synth->busses[BUS_STEM + i], n);
+
+        if (TELEMETRY)
+            synth->telemetry.time_resonator += synth_lap (&time);
+
+        if (synth->n_workers_busy)
+            synth_workers_wait (synth);
+
+        synth_voices_retire (synth);
+
+        if (TELEMETRY)
+            synth->telemetry.time_strings += synth_lap (&time);
+
+        __atomic_store_n (&synth->frame, synth->frame + n, __ATOMIC_RELAXED);
+        n_frames -= n;
+    }
+}
+
+void synth_process_midi_note_off (synth_t *synth, int channel, int note, int velocity) {
+
+    voice_note_off (&synth->voices[note], velocity);
+}
+
+void synth_process_midi_note_on (synth_t *synth, int channel, int note, int velocity) {
+
+    /* no string there */
+    if (note < synth->voice_min || note >= synth->voice_max)
+        return;
+
+    synth_voice_activate (synth, note, 1);
+    if (synth->commuted && synth->excitations)
+        voice_pluck_set (&synth->voices[note], synth->voices[note].rate > synth->rate
+                                               ? &synth->excitations->plucks_oversampled[note]
+                                               : &synth->excitations->plucks[note]);
+    voice_note_on (&synth->voices[note], velocity);
+    synth->telemetry.n_notes++;
+}
+
+void synth_process_midi_cc (synth_t *synth, int channel, int controller, int value) {
+
+    size_t i;
+
+    switch (controller) {
+
+        /* only the strings running now, the others take it up when they wake */
+        case 1: /* modulation wheel */
+            synth->damper = value / 127.0;
+            for (i = 0; i < synth->n_voices_active; i++)
+                voice_damper_set (&synth->voices[synth->voices_active[i]], synth->damper);
+            break;
+
+        case 11: /* expression */
+            break;
+
+        case 64: /* sustain pedal */
+            synth->sustain = value / 127.0;
+            for (i = 0; i < synth->n_voices_active; i++)
+                voice_sustain_set (&synth->voices[synth->voices_active[i]], synth->sustain);
+            break;
+    }
+}
+
+void synth_process_midi_bend (synth_t *synth, int channel, int lsb, int msb) {
+
+    size_t i;
+    int value = (msb << 7) | lsb;
+    synth->bend = pow (2, (value / (double) 0x2000 - 1) * synth->patch.bend_range / 12);
+
+    /* only the strings running now, the others take it up when they wake */
+    for (i = 0; i < synth->n_voices_active; i++)
+        voice_bend_set (&synth->voices[synth->voices_active[i]], synth->bend);
+}
+
+/* queues a three byte message for synth_log_drain,
+ * dropping it if the ring is full rather than waiting */
+static void synth_log (synth_t *synth, jack_midi_data_t *data) {
+
+    message_t *message = ring_reserve (&synth->ring_log);
+
+    if (!message) {
+
+        __atomic_add_fetch (&synth->n_messages_dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    message->frame = synth->frame;
+    memcpy (message->data, data, sizeof (message->data));
+    ring_commit (&synth->ring_log);
+}
+
+/* prints the messages logged so far, from a thread other than the process thread */
+void synth_log_drain (synth_t *synth, FILE *stream) {
+
+    message_t *message;
+    unsigned long n_dropped = __atomic_exchange_n (&synth->n_messages_dropped, 0, __ATOMIC_RELAXED);
+
+    while ((message = ring_peek (&synth->ring_log))) {
+
+        jack_midi_data_t *data = message->data;
+
+        switch (data[0] & 0xf0) {
+
+            case 0x80:
+                fprintf (stream, "note off: %x %x\n", data[1], data[2]);
+                break;
+
+            case 0x90:
+                fprintf (stream, "note on: %x %x\n", data[1], data[2]);
+                break;
+
+            case 0xb0:
+                fprintf (stream, "control change: %x %x\n", data[1], data[2]);
+                break;
+
+            case 0xc0:
+                fprintf (stream, "program change: %x\n", data[1]);
+                break;
+
+            case 0xe0:
+                fprintf (stream, "pitch bend: %x %x\n", data[1], data[2]);
+                break;
+        }
+
+        ring_pop (&synth->ring_log);
+    }
+
+    if (n_dropped)
+        fprintf (stream, "dropped %lu messages\n", n_dropped);
+    fflush (stream);
+}
+
+/* starts timing a period, on the process thread */
+void synth_period_begin (synth_t *synth) {
+
+    if (!TELEMETRY)
+        return;
+
+    memset (&synth->telemetry, 0, sizeof (telemetry_t));
+    synth->telemetry.frame = synth->frame;
+    synth->telemetry.program = synth->program;
+    synth->telemetry.tier = synth->tier;
+    synth->time_period = synth_clock ();
+}
+
+/* queues the period of n_frames for synth_telemetry_drain */
+void synth_period_end (synth_t *synth, jack_nframes_t n_frames) {
+
+    telemetry_t *telemetry;
+
+    if (!TELEMETRY || !n_frames)
+        return;
+
+    synth->telemetry.n_frames = n_frames;
+    synth->telemetry.time = synth_clock () - synth->time_period;
+
+    if (!(telemetry = ring_reserve (&synth->ring_telemetry))) {
+
+        __atomic_add_fetch (&synth->n_periods_dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    *telemetry = synth->telemetry;
+    ring_commit (&synth->ring_telemetry);
+}
+
+/* from any thread, as soon as jack misses a deadline */
+void synth_xrun (synth_t *synth) {
+
+    __atomic_add_fetch (&synth->n_xruns, 1, __ATOMIC_RELAXED);
+}
+
+/* prints the periods summed up since the last report and starts over */
+void synth_report (synth_t *synth, FILE *stream) {
+
+    report_t *report = &synth->report;
+    telemetry_t *worst = &report->worst;
+
+    if (!report->n_periods)
+        return;
+
+    fprintf (stream, "load %.1f %% over %.1f s from frame %lu, %lu notes, %u voices at most; "
+                     "worst period %.1f %% at frame %lu (%u frames, %u voices, %u notes, program %d, tier %d): "
+                     "midi %.0f us, strings %.0f us, body %.0f us\n",
+             100 * report->time / report->time_audio, report->time_audio, (unsigned long) report->frame,
+             report->n_notes, report->n_voices_max,
+             100 * report->load_worst, (unsigned long) worst->frame,
+             worst->n_frames, worst->n_voices_max, worst->n_notes, worst->program, worst->tier,
+             worst->time_midi * 1e6, worst->time_strings * 1e6, worst->time_resonator * 1e6);
+    fflush (stream);
+
+    memset (report, 0, sizeof (report_t));
+}
+
+/* sums up the periods processed so far, from a thread other than the process
+ * thread, reporting every TELEMETRY_INTERVAL of audio and after every xrun,
+ * so that the worst period leading up to it shows what was playing */
+void synth_telemetry_drain (synth_t *synth, FILE *stream) {
+
+    telemetry_t *telemetry;
+    report_t *report = &synth->report;
+    unsigned long n_xruns = __atomic_load_n (&synth->n_xruns, __ATOMIC_RELAXED);
+    unsigned long n_dropped = __atomic_exchange_n (&synth->n_periods_dropped, 0, __ATOMIC_RELAXED);
+
+    while ((telemetry = ring_peek (&synth->ring_telemetry))) {
+
+        double time_audio = telemetry->n_frames / synth->rate;
+        double load = telemetry->time / time_audio;
+
+        if (!report->n_periods)
+            report->frame = telemetry->frame;
+        report->n_periods++;
+        report->time += telemetry->time;
+        report->time_audio += time_audio;
+        report->n_notes += telemetry->n_notes;
+        if (report->n_voices_max < telemetry->n_voices_max)
+            report->n_voices_max = telemetry->n_voices_max;
+        if (load >= report->load_worst) {
+
+            report->load_worst = load;
+            report->worst = *telemetry;
+        }
+
+        ring_pop (&synth->ring_telemetry);
+
+        if (TELEMETRY_INTERVAL && report->time_audio >= TELEMETRY_INTERVAL)
+            synth_report (synth, stream);
+    }
+
+    if (n_xruns != synth->n_xruns_reported) {
+
+        fprintf (stream, "%lu xruns!! 😱 ", n_xruns - synth->n_xruns_reported);
+        synth->n_xruns_reported = n_xruns;
+        if (report->n_periods)
+            synth_report (synth, stream);
+        else
+            fputs ("nothing measured since da last report\n", stream);
+    }
+
+    if (n_dropped)
+        fprintf (stream, "dropped %lu periods of telemetry\n", n_dropped);
+    fflush (stream);
+}
+
+static void *synth_logger_run (void *arg) {
+
+    synth_t *synth = arg;
+    struct timespec interval;
+
+    interval.tv_sec = 0;
+    interval.tv_nsec = LOGGER_INTERVAL * 1000000L;
+
+    while (__atomic_load_n (&synth->logger_running, __ATOMIC_ACQUIRE)) {
+
+        synth_log_drain (synth, stdout);
+        synth_telemetry_drain (synth, stdout);
+        nanosleep (&interval, NULL);
+    }
+
+    synth_log_drain (synth, stdout);
+    synth_telemetry_drain (synth, stdout);
+    return NULL;
+}
+
+/* prints the log and the telemetry from a thread of its own at normal priority */
+void synth_logger_start (synth_t *synth) {
+
+    synth->logger_running = true;
+    pthread_create (&synth->logger, NULL, synth_logger_run, synth);
+}
+
+void synth_logger_stop (synth_t *synth) {
+
+    __atomic_store_n (&synth->logger_running, false, __ATOMIC_RELEASE);
+    pthread_join (synth->logger, NULL);
+}
+
+/* frees the kernels the resonators are done with and crossfades them to the
+ * program asked for last, from a thread other than the process thread */
+void synth_loader_poll (synth_t *synth) {
+
+    int program = __atomic_load_n (&synth->program, __ATOMIC_ACQUIRE);
+    buffer_t impulse_response;
+    double rate;
+
+    convolver_kernel_collect (&synth->resonator_left.convolver);
+    if (synth->patch.output_pan_spread)
+        convolver_kernel_collect (&synth->resonator_right.convolver);
+    excitations_destroy (__atomic_exchange_n (&synth->excitations_retired, NULL, __ATOMIC_ACQUIRE));
+
+    /* programs asked for while a swap is pending are skipped but the last */
+    if (program == synth->program_loaded
+        || __atomic_load_n (&synth->excitations_next, __ATOMIC_ACQUIRE)
+        || convolver_kernel_pending (&synth->resonator_left.convolver)
+        || (synth->patch.output_pan_spread && convolver_kernel_pending (&synth->resonator_right.convolver)))
+        return;
+
+    synth->program_loaded = program;
+
+    pthread_mutex_lock (&synth->mutex_load);
+
+    if (!synth_program_load (synth, program, &impulse_response, &rate)) {
+
+        pthread_mutex_unlock (&synth->mutex_load);
+        return;
+    }
+
+    synth_impulse_response_set (synth, &impulse_response, rate);
+    if (synth->commuted) {
+
+        __atomic_store_n (&synth->excitations_next, synth_excitations_create (synth), __ATOMIC_RELEASE);
+
+    } else if (synth->patch.resonance_body) {
+
+        convolver_kernel_post (&synth->resonator_left.convolver, synth_kernel_create (synth));
+        if (synth->patch.output_pan_spread)
+            convolver_kernel_post (&synth->resonator_right.convolver, synth_kernel_create (synth));
+    }
+
+    pthread_mutex_unlock (&synth->mutex_load);
+}
+
+/* whether synth_loader_poll has anything to do, from the process thread
+ * while it is not running */
+bool synth_loader_due (synth_t *synth) {
+
+    return synth->program != synth->program_loaded
+        || __atomic_load_n (&synth->resonator_left.convolver.kernel_retired, __ATOMIC_RELAXED)
+        || (synth->patch.output_pan_spread && __atomic_load_n (&synth->resonator_right.convolver.kernel_retired, __ATOMIC_RELAXED))
+        || __atomic_load_n (&synth->excitations_retired, __ATOMIC_RELAXED);
+}
+
+static void *synth_loader_run (void *arg) {
+
+    synth_t *synth = arg;
+    struct timespec interval;
+
+    interval.tv_sec = 0;
+    interval.tv_nsec = LOADER_INTERVAL * 1000000L;
+
+    while (__atomic_load_n (&synth->loader_running, __ATOMIC_ACQUIRE)) {
+
+        synth_loader_poll (synth);
+        nanosleep (&interval, NULL);
+    }
+
+    return NULL;
+}
+
+/* loads impulse responses from a thread of its own at normal priority,
+ * so that the process thread never touches files or the heap for them */
+void synth_loader_start (synth_t *synth) {
+
+    synth->loader_running = true;
+    pthread_create (&synth->loader, NULL, synth_loader_run, synth);
+}
+
+void synth_loader_stop (synth_t *synth) {
+
+    __atomic_store_n (&synth->loader_running, false, __ATOMIC_RELEASE);
+    pthread_join (synth->loader, NULL);
+}
+
+void synth_process_midi (synth_t *synth, jack_midi_data_t *data) {
+
+    int status  = data[0] & 0xf0;
+    int channel = data[0] & 0x0f;
+    double time = TELEMETRY ? synth_clock () : 0;
+
+    switch (status) {
+
+        case 0x80: /* note off */
+            synth_log (synth, data);
+            synth_process_midi_note_off (synth, channel, data[1], data[2]);
+            break;
 
         case 0x90: /* note on */
-            printf ("note on: %x %x\n", data[1], data[2]);
+            synth_log (synth, data);
             synth_process_midi_note_on (synth, channel, data[1], data[2]);
             break;
 
-        case 0xa0: /* polyphonic key pressure */
-            break;
+        case 0xa0: /* polyphonic key pressure */
+            break;
+
+        case 0xb0: /* control change */
+            synth_log (synth, data);
+            synth_process_midi_cc (synth, channel, data[1], data[2]);
+            break;
+
+        case 0xc0: /* program change, see synth_loader_poll */
+            synth_log (synth, data);
+            __atomic_store_n (&synth->program, data[1], __ATOMIC_RELEASE);
+            break;
+
+        case 0xd0: /* channel pressure */
+            break;
+
+        case 0xe0: /* pitch bend */
+            synth_log (synth, data);
+            synth_process_midi_bend (synth, channel, data[1], data[2]);
+            break;
+    }
+
+    if (TELEMETRY)
+        synth->telemetry.time_midi += synth_lap (&time);
+}
+
+/* frames processed so far, readable from any thread */
+uint64_t synth_frame (synth_t *synth) {
+
+    return __atomic_load_n (&synth->frame, __ATOMIC_RELAXED);
+}
+
+/* hands a three byte midi message to synth_process from any thread other than
+ * the process thread, to be applied at frame (see synth_frame) or right away
+ * if that has passed; posts must come in frame order, false if the queue is full */
+bool synth_post (synth_t *synth, uint64_t frame, const jack_midi_data_t *data) {
+
+    message_t *message;
+
+    pthread_mutex_lock (&synth->mutex_post);
+
+    if ((message = ring_reserve (&synth->ring_control))) {
+
+        message->frame = frame;
+        memcpy (message->data, data, sizeof (message->data));
+        ring_commit (&synth->ring_control);
+    }
+
+    pthread_mutex_unlock (&synth->mutex_post);
+
+    return message;
+}
+
+/* synth_process_audio, applying the posted messages due within the
+ * n_frames on the frame they were posted for */
+void synth_process (synth_t *synth,
+                    jack_nframes_t n_frames,
+                    jack_default_audio_sample_t **outputs) {
+
+    for (;;) {
+
+        message_t *message = ring_peek (&synth->ring_control);
+        jack_nframes_t n = n_frames;
+
+        if (message && message->frame < synth->frame + n_frames)
+            n = message->frame > synth->frame ? message->frame - synth->frame : 0;
+        else
+            message = NULL;
+
+        synth_process_audio (synth, n, outputs);
+        n_frames -= n;
+
+        if (!message)
+            break;
+
+        synth_process_midi (synth, message->data);
+        ring_pop (&synth->ring_control);
+    }
+}
+
+/* steps the synths down a tier for every period taking longer than
+ * GOVERNOR_LOAD_DOWN of its own length, and back up one for every
+ * GOVERNOR_TIME_UP of audio spent under GOVERNOR_LOAD_UP; the tiers given
+ * up are cheap to take back, the body and the strings coming back gradually */
+typedef struct governor_t {
+
+    int tier;
+    double time_up;                 /* s of audio under GOVERNOR_LOAD_UP so far */
+
+} governor_t;
+
+void governor_init (governor_t *governor) {
+
+    memset (governor, 0, sizeof (governor_t));
+}
+
+void governor_terminate (governor_t *governor) {
+
+}
+
+/* the tier after a period of n_frames at rate that took time s */
+int governor_process (governor_t *governor, double time, jack_nframes_t n_frames, double rate) {
+
+    double time_audio = n_frames / rate;
+
+    if (!n_frames)
+        return governor->tier;
+
+    if (time > GOVERNOR_LOAD_DOWN * time_audio) {
+
+        if (governor->tier < N_TIERS - 1)
+            governor->tier++;
+        governor->time_up = 0;
+
+    } else if (time > GOVERNOR_LOAD_UP * time_audio) {
+
+        governor->time_up = 0;
+
+    } else if ((governor->time_up += time_audio) >= GOVERNOR_TIME_UP) {
+
+        if (governor->tier > TIER_FULL)
+            governor->tier--;
+        governor->time_up = 0;
+    }
+
+    return governor->tier;
+}
+
+/* several synths in one process, each playing the midi channels given to it
+ * with a patch of its own, taking turns at one pool of workers and sharing
+ * one library of bodies and kernels, one arena of delay lines, and a
+ * coefficient table between those whose patches are the same */
+typedef struct ensemble_t {
+
+    synth_t *synths[N_CHANNELS];    /* in the order added */
+    size_t n_synths;
+    synth_t *channels[N_CHANNELS];  /* who plays each, NULL for nobody */
+
+    library_t library;              /* its patch is the one of those given none */
+    pool_t pool;
+    coefficients_t coefficients[N_CHANNELS];    /* one per distinct patch, in the order added */
+    sample_t *delays;
+    double rate;
+    governor_t governor;            /* of all of them at once, they share the deadline */
+
+    pthread_t service;
+    bool service_running;
+
+} ensemble_t;
+
+/* playing the patch at PATH_PATCH */
+void ensemble_init (ensemble_t *ensemble) {
+
+    memset (ensemble, 0, sizeof (ensemble_t));
+    library_init (&ensemble->library, "");
+    governor_init (&ensemble->governor);
+}
+
+void ensemble_terminate (ensemble_t *ensemble) {
+
+    size_t i;
+
+    for (i = 0; i < ensemble->n_synths; i++) {
+
+        synth_terminate (ensemble->synths[i]);
+        free (ensemble->synths[i]);
+    }
+
+    library_terminate (&ensemble->library);
+    free (ensemble->delays);
+    governor_terminate (&ensemble->governor);
+}
+
+/* a synth playing patch on channel (counted from 1, 0 for every one nobody
+ * else plays) with program and the strings from voice_min up to voice_max,
+ * before the rate is set; NULL once every channel is taken */
+synth_t *ensemble_add (ensemble_t *ensemble, const patch_t *patch,
+                       int channel, int program, int voice_min, int voice_max) {
+
+    size_t i;
+    synth_t *synth;
+
+    if (ensemble->n_synths == N_CHANNELS || channel < 0 || channel > N_CHANNELS)
+        return NULL;
+
+    synth = malloc (sizeof (synth_t));
+    synth_init_shared (synth, patch, &ensemble->library);
+    synth_range_set (synth, voice_min, voice_max);
+    synth_program_set (synth, program);
+    synth->pool = &ensemble->pool;
+    synth->mix = true;
+    ensemble->synths[ensemble->n_synths++] = synth;
+
+    for (i = 0; i < N_CHANNELS; i++)
+        if (channel ? i == (size_t) channel - 1 : !ensemble->channels[i])
+            ensemble->channels[i] = synth;
+
+    return synth;
+}
+
+/* one coefficient table for each patch and one allocation of delay lines for all of them */
+void ensemble_rate_set (ensemble_t *ensemble, double rate) {
+
+    size_t i;
+    size_t n_samples = 0;
+    size_t n_coefficients = 0;
+    sample_t *pointer;
+
+    ensemble->rate = rate;
+
+    for (i = 0; i < ensemble->n_synths; i++)
+        n_samples += synth_delays_n_samples (ensemble->synths[i], rate);
+
+    free (ensemble->delays);
+    if (posix_memalign ((void **) &ensemble->delays, SIZE_CACHE_LINE, (n_samples ? n_samples : 1) * sizeof (sample_t))) {
+
+        fputs ("no memory for da strings 😭\n", stderr);
+        exit (EXIT_FAILURE);
+    }
+
+    pointer = ensemble->delays;
+    for (i = 0; i < ensemble->n_synths; i++) {
+
+        size_t j;
+        synth_t *synth = ensemble->synths[i];
+
+        /* the table of the first one added with the same patch, or a new one */
+        for (j = 0; j < i && !patch_equal (&ensemble->synths[j]->patch, &synth->patch); j++)
+            ;
+        if (j == i)
+            coefficients_init (&ensemble->coefficients[n_coefficients++], &synth->patch, rate);
+
+        synth_rate_set_shared (synth, rate,
+                               j < i ? ensemble->synths[j]->coefficients_rate
+                                     : &ensemble->coefficients[n_coefficients - 1],
+                               pointer);
+        pointer += synth_delays_n_samples (synth, rate);
+    }
+}
+
+/* the synth a midi message goes to, NULL if nobody plays its channel */
+synth_t *ensemble_synth (ensemble_t *ensemble, const jack_midi_data_t *data) {
+
+    if (data[0] >= 0xf0)
+        return NULL;
+
+    return ensemble->channels[data[0] & 0x0f];
+}
+
+/* weighs a period of n_frames that took time s to process, stepping every
+ * synth to the tier the governor settles on; on the process thread */
+void ensemble_govern (ensemble_t *ensemble, double time, jack_nframes_t n_frames) {
+
+    size_t i;
+    int tier;
+
+    if (!GOVERNOR || !ensemble->rate)
+        return;
+
+    tier = governor_process (&ensemble->governor, time, n_frames, ensemble->rate);
+    for (i = 0; i < ensemble->n_synths; i++)
+        if (ensemble->synths[i]->tier != tier)
+            synth_tier_set (ensemble->synths[i], tier);
+}
+
+/* counts an xrun against every synth, since they all took part */
+void ensemble_xrun (ensemble_t *ensemble) {
+
+    size_t i;
+
+    for (i = 0; i < ensemble->n_synths; i++)
+        synth_xrun (ensemble->synths[i]);
+}
+
+static void *ensemble_service_run (void *arg) {
+
+    ensemble_t *ensemble = arg;
+    struct timespec interval;
+    size_t i;
+
+    interval.tv_sec = 0;
+    interval.tv_nsec = LOGGER_INTERVAL * 1000000L;
+
+    while (__atomic_load_n (&ensemble->service_running, __ATOMIC_ACQUIRE)) {
+
+        for (i = 0; i < ensemble->n_synths; i++) {
+
+            synth_log_drain (ensemble->synths[i], stdout);
+            synth_telemetry_drain (ensemble->synths[i], stdout);
+            synth_loader_poll (ensemble->synths[i]);
+        }
+        nanosleep (&interval, NULL);
+    }
+
+    for (i = 0; i < ensemble->n_synths; i++) {
+
+        synth_log_drain (ensemble->synths[i], stdout);
+        synth_telemetry_drain (ensemble->synths[i], stdout);
+    }
+
+    return NULL;
+}
+
+/* logs, reports and loads bodies for every synth from one thread at normal
+ * priority, rather than a logger and a loader each */
+void ensemble_service_start (ensemble_t *ensemble) {
+
+    ensemble->service_running = true;
+    pthread_create (&ensemble->service, NULL, ensemble_service_run, ensemble);
+}
+
+void ensemble_service_stop (ensemble_t *ensemble) {
+
+    __atomic_store_n (&ensemble->service_running, false, __ATOMIC_RELEASE);
+    pthread_join (ensemble->service, NULL);
+}
+
+#ifndef TARGET_LV2
+
+typedef struct jack_context_t {
+
+    jack_client_t *client;
+    jack_port_t *port_midi_in;
+    jack_port_t *ports_audio_out[N_OUTPUTS];
+
+    ensemble_t ensemble;
+
+} jack_context_t;
+
+int jack_process (jack_nframes_t n_frames, void *arg) {
+
+    size_t i;
+    double time = synth_clock ();
+
+    jack_context_t *context = (jack_context_t *) arg;
+
+    jack_default_audio_sample_t *buffers_audio_out[N_OUTPUTS];
+    void *buffer_midi_in = jack_port_get_buffer (context->port_midi_in, n_frames);
+
+    jack_nframes_t n_events = jack_midi_get_event_count (buffer_midi_in);
+
+    ensemble_t *ensemble = &context->ensemble;
+    size_t i_synth;
+
+    /* left out where nobody listens, the synths add themselves in */
+    for (i = 0; i < N_OUTPUTS; i++) {
+
+        buffers_audio_out[i] = jack_port_connected (context->ports_audio_out[i])
+                             ? jack_port_get_buffer (context->ports_audio_out[i], n_frames)
+                             : NULL;
+        if (buffers_audio_out[i])
+            memset (buffers_audio_out[i], 0, n_frames * sizeof (jack_default_audio_sample_t));
+    }
+
+    /* one after the other, each through the events of its own channels */
+    for (i_synth = 0; i_synth < ensemble->n_synths; i_synth++) {
+
+        synth_t *synth = ensemble->synths[i_synth];
+        jack_default_audio_sample_t *outputs[N_OUTPUTS];
+        size_t i_frame = 0;
+
+        memcpy (outputs, buffers_audio_out, sizeof (outputs));
+        synth_period_begin (synth);
+
+        for (i = 0; i < n_events; i++) {
+
+            jack_midi_event_t event;
+            jack_midi_event_get (&event, buffer_midi_in, i);
+            if (ensemble_synth (ensemble, event.buffer) != synth)
+                continue;
+
+            /* process audio frames up to the time of this event */
+            synth_process (synth, event.time - i_frame, outputs);
+            i_frame = event.time;
+
+            /* process the midi event */
+            synth_process_midi (synth, event.buffer);
+        }
+
+        /* process remaining audio frames */
+        synth_process (synth, n_frames - i_frame, outputs);
+
+        synth_period_end (synth, n_frames);
+    }
+
+    /* the next period has to make do with what this one left */
+    ensemble_govern (ensemble, synth_clock () - time, n_frames);
+
+    /* process audio */
+    return 0;
+}
+
+int jack_xrun (void *arg) {
+
+    jack_context_t *context = (jack_context_t *) arg;
+
+    ensemble_xrun (&context->ensemble);
+
+    return 0;
+}
+
+int jack_set_rate (jack_nframes_t rate, void *arg) {
+
+    jack_context_t *context = (jack_context_t *) arg;
+
+    ensemble_rate_set (&context->ensemble, rate);
+
+    return 0;
+}
+
+void jack_shutdown (void *arg) {
+
+    fputs ("what...... jack shutdown apparently..... bye bye.... x_x", stderr);
+    exit (EXIT_FAILURE);
+}
+
+#endif
+
+#ifdef TARGET_BENCH
+
+#define BENCH_RATE 48000
+#define BENCH_SECONDS 2 /* of audio per measurement */
+#define BENCH_N_FRAMES 32 /* below the shortest string */
+#define BENCH_N_FRAMES_BUDGET 64 /* the period the budget is a share of */
+#define BENCH_N_EXCITES 1000
+#define BENCH_NOTE 60
+#define BENCH_STRINGS_SECONDS 4
+#define BENCH_STRINGS_WINDOW 0.05 /* s */
+#define BENCH_N_ELEMENTS(array) (sizeof (array) / sizeof (*(array)))
+
+static const size_t bench_n_voices[] = { 1, 8, 32, VOICE_MAX - VOICE_MIN };
+static const size_t bench_n_frames[] = { 32, 64, 256 };
+static const size_t bench_n_samples_ir[] = { 512, 2048, 8192, 48000, 192000 };
+
+#if PRECISION == PRECISION_DOUBLE
+static const char *bench_precision = "double";
+#elif PRECISION == PRECISION_FLOAT
+static const char *bench_precision = "float";
+#else
+static const char *bench_precision = "mixed";
+#endif
+
+/* results are added here so the work cannot be optimized away */
+static volatile double bench_sink;
+
+static patch_t bench_patch;        /* of the strings benched on their own, the defaults whatever PATH_PATCH says */
+static coefficients_t bench_coefficients;
+
+static double noise () {
+
+    return rand () / (double) RAND_MAX;
+}
+
+static double bench_clock () {
+
+    struct timespec time;
+    clock_gettime (CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/* one csv row, seconds_period being the time spent on the work
+ * of one BENCH_N_FRAMES_BUDGET frame period */
+static void bench_print (const char *stage,
+                         const char *variant,
+                         size_t n_frames_block,
+                         double ns_per_sample,
+                         double seconds_period) {
+
+    double period = BENCH_N_FRAMES_BUDGET / (double) BENCH_RATE;
+
+    printf ("%s,%s,%lu,%.3f,%.2f,%.3f\n",
+            stage, variant, (unsigned long) n_frames_block,
+            ns_per_sample, period / seconds_period, 100 * seconds_period / period);
+}
+
+/* for stages producing a stream of n_frames */
+static void bench_report (const char *stage,
+                          const char *variant,
+                          size_t n_frames_block,
+                          double seconds,
+                          size_t n_frames) {
+
+    bench_print (stage, variant, n_frames_block,
+                 seconds * 1e9 / n_frames,
+                 seconds * BENCH_N_FRAMES_BUDGET / n_frames);
+}
+
+static void bench_filter () {
+
+    size_t i;
+    size_t n_samples = BENCH_RATE * BENCH_SECONDS;
+    filter_t filter;
+    double sum = 0;
+    double start;
+
+    filter_init (&filter);
+    filter_cutoff_set (&filter, CUTOFF_DAMPER, BENCH_RATE);
+
+    start = bench_clock ();
+    for (i = 0; i < n_samples; i++)
+        sum += filter_process (&filter, i & 1 ? 1 : -1);
+    bench_report ("filter", "low_pass", 1, bench_clock () - start, n_samples);
+
+    start = bench_clock ();
+    for (i = 0; i < n_samples; i++)
+        sum += filter_process_high_pass (&filter, i & 1 ? 1 : -1);
+    bench_report ("filter", "high_pass", 1, bench_clock () - start, n_samples);
+
+    filter_terminate (&filter);
+    bench_sink += sum;
+}
+
+static void bench_delay () {
+
+    size_t i;
+    size_t n_samples = BENCH_RATE * BENCH_SECONDS;
+    delay_t delay;
+    sample_t buffer[BENCH_RATE / 440];
+    double start;
+
+    memset (buffer, 0, sizeof (buffer));
+    delay_init (&delay, BENCH_RATE / 440, buffer);
+    delay_length_set (&delay, BENCH_RATE / 440);
+
+    /* a lossy loop, as a string would run it */
+    start = bench_clock ();
+    for (i = 0; i < n_samples; i++)
+        delay_process (&delay, 0.99 * *delay_tap (&delay, 0) + !i);
+    bench_report ("delay", "feedback", 1, bench_clock () - start, n_samples);
+
+    bench_sink += *delay_tap (&delay, 0);
+    delay_terminate (&delay);
+}
+
+static void bench_convolver () {
+
+    size_t i;
+    size_t j;
+    size_t n_samples = BENCH_RATE * BENCH_SECONDS;
+    sample_t input[N_FRAMES_BLOCK];
+    sample_t output[N_FRAMES_BLOCK];
+
+    for (i = 0; i < N_FRAMES_BLOCK; i++)
+        input[i] = noise () * 2 - 1;
+
+    for (i = 0; i < BENCH_N_ELEMENTS (bench_n_samples_ir); i++) {
+
+        for (j = 0; j < BENCH_N_ELEMENTS (bench_n_frames); j++) {
+
+            size_t k;
+            size_t n_samples_ir = bench_n_samples_ir[i];
+            size_t n_frames = bench_n_frames[j];
+            buffer_t impulse_response;
+            convolver_t convolver;
+            char variant[32];
+            double start;
+
+            /* decaying noise stands in for a body */
+            buffer_init (&impulse_response, n_samples_ir, calloc (n_samples_ir, sizeof (sample_t)));
+            for (k = 0; k < n_samples_ir; k++)
+                impulse_response.data[k] = (noise () * 2 - 1) * exp (-8.0 * k / n_samples_ir);
+            convolver_init (&convolver);
+            convolver_kernel_set (&convolver, kernel_create (&impulse_response));
+            buffer_terminate (&impulse_response);
+
+            start = bench_clock ();
+            for (k = 0; k < n_samples; k += n_frames) {
+
+                convolver_process_block (&convolver, input, output, n_frames);
+                bench_sink += output[0];
+            }
+
+            sprintf (variant, "ir=%lu", (unsigned long) n_samples_ir);
+            bench_report ("convolver", variant, n_frames, bench_clock () - start, n_samples);
+
+            convolver_terminate (&convolver);
+        }
+    }
+}
+
+/* one bus brought down from twice the rate, n_frames of output at a time */
+static void bench_half_band () {
+
+    size_t i;
+    size_t n_samples = BENCH_RATE * BENCH_SECONDS;
+    sample_t input[N_FRAMES_BLOCK];
+    sample_t output[N_FRAMES_BLOCK / 2];
+
+    for (i = 0; i < N_FRAMES_BLOCK; i++)
+        input[i] = noise () * 2 - 1;
+
+    for (i = 0; i < BENCH_N_ELEMENTS (bench_n_frames); i++) {
+
+        size_t j;
+        size_t n_frames = bench_n_frames[i];
+        half_band_t half_band;
+        double start;
+
+        if (2 * n_frames > N_FRAMES_BLOCK)
+            continue;
+
+        half_band_init (&half_band);
+
+        start = bench_clock ();
+        for (j = 0; j < n_samples; j += n_frames) {
+
+            half_band_process (&half_band, input, output, n_frames);
+            bench_sink += output[0];
+        }
+        bench_report ("half_band", "decimate", n_frames, bench_clock () - start, n_samples);
+
+        half_band_terminate (&half_band);
+    }
+}
+
+/* one string through voice_process_block and voice_input_block */
+static void bench_voice () {
+
+    size_t i;
+    size_t n_samples = BENCH_RATE * BENCH_SECONDS;
+    sample_t buffer[N_FRAMES_BLOCK];
+    sample_t input[N_FRAMES_BLOCK];
+
+    memset (input, 0, sizeof (input));
+
+    for (i = 0; i < BENCH_N_ELEMENTS (bench_n_frames); i++) {
+
+        size_t j;
+        size_t n_frames = bench_n_frames[i];
+        size_t n_samples_delay;
+        voice_t voice;
+        sample_t *delay;
+        double start;
+
+        voice_init (&voice, BENCH_NOTE, &bench_patch);
+        voice_rate_set (&voice, &bench_coefficients);
+        n_samples_delay = voice_n_samples_max (&voice, BENCH_RATE);
+        delay = calloc (n_samples_delay, sizeof (sample_t));
+        voice_buffer_set (&voice, delay, n_samples_delay);
+        voice_note_on (&voice, 100);
+
+        /* blocks may not be longer than the string */
+        if (n_frames <= voice.delay.n_samples) {
+
+            start = bench_clock ();
+            for (j = 0; j < n_samples; j += n_frames) {
+
+                voice_excite_block (&voice, n_frames);
+                voice_process_block (&voice, buffer, n_frames);
+                voice_input_block (&voice, input, n_frames);
+                bench_sink += buffer[0];
+            }
+            bench_report ("voice", "scalar", n_frames, bench_clock () - start, n_samples);
+        }
+
+        voice_terminate (&voice);
+        free (delay);
+    }
+}
+
+/* the cost a note on adds to the block it lands in */
+static void bench_excite () {
+
+    int notes[] = { VOICE_MIN, BENCH_NOTE, VOICE_MAX - 1 };
+    size_t i;
+
+    for (i = 0; i < BENCH_N_ELEMENTS (notes); i++) {
+
+        size_t j;
+        size_t n_samples_delay;
+        size_t n_frames;
+        voice_t voice;
+        sample_t *delay;
+        char variant[32];
+        double start;
+        double seconds;
+
+        voice_init (&voice, notes[i], &bench_patch);
+        voice_rate_set (&voice, &bench_coefficients);
+        n_samples_delay = voice_n_samples_max (&voice, BENCH_RATE);
+        delay = calloc (n_samples_delay, sizeof (sample_t));
+        voice_buffer_set (&voice, delay, n_samples_delay);
+
+        n_frames = N_FRAMES_BLOCK < voice.delay.n_samples ? N_FRAMES_BLOCK : voice.delay.n_samples;
+
+        start = bench_clock ();
+        for (j = 0; j < BENCH_N_EXCITES; j++) {
+
+            voice_note_on (&voice, 127);
+            voice_excite_block (&voice, n_frames);
+        }
+        seconds = bench_clock () - start;
+
+        sprintf (variant, "note=%d", notes[i]);
+        bench_print ("excite", variant, n_frames,
+                     seconds * 1e9 / BENCH_N_EXCITES / n_frames,
+                     seconds / BENCH_N_EXCITES);
+
+        bench_sink += *voice.delay.buffer_pointer;
+        voice_terminate (&voice);
+        free (delay);
+    }
+}
+
+/* runs the strings of a chord over the whole playable range, as
+ * synth_process_audio would, returns seconds spent */
+static double bench_voice_bank (bool voice_bank, sample_t *output) {
+
+    size_t i;
+    double start;
+    synth_t *synth = malloc (sizeof (synth_t));
+    sample_t input[1][N_FRAMES_BLOCK];
+
+    srand (1);
+    synth_init (synth);
+    synth_rate_set (synth, BENCH_RATE);
+
+    for (i = VOICE_MIN; i < VOICE_MAX; i++)
+        synth_process_midi_note_on (synth, 0, i, 100);
+
+    start = bench_clock ();
+    for (i = 0; i < BENCH_RATE * BENCH_SECONDS; i += BENCH_N_FRAMES) {
+
+        size_t j;
+        sample_t *buffer = output + i;
+
+        for (j = 0; j < BENCH_N_FRAMES; j++)
+            input[0][j] = SYMPATHETIC_RESONANCE * (j ? buffer[j - 1] : i ? buffer[-1] : 0) / N_VOICES;
+        for (j = 0; j < synth->n_voices_active; j++)
+            voice_excite_block (&synth->voices[synth->voices_active[j]], BENCH_N_FRAMES);
+        synth_busses_clear (synth, synth->busses, BENCH_N_FRAMES);
+
+        if (voice_bank) {
+
+            voice_bank_load (&synth->voice_bank, synth->voices, synth->voices_active, synth->n_voices_active);
+            voice_bank_process_block (&synth->voice_bank, synth->busses, 0, BENCH_N_FRAMES);
+            voice_bank_input_block (&synth->voice_bank, input, 1, BENCH_N_FRAMES);
+            voice_bank_store (&synth->voice_bank);
+
+        } else {
+
+            for (j = 0; j < synth->n_voices_active; j++) {
+
+                voice_t *voice = &synth->voices[synth->voices_active[j]];
+                voice_process_block (voice, synth->buffer_voice, BENCH_N_FRAMES);
+                voice_mix_block (voice, synth->buffer_voice, synth->busses, 0, BENCH_N_FRAMES);
+                voice_input_block (voice, input[0], BENCH_N_FRAMES);
+            }
+        }
+
+        memcpy (buffer, synth->busses[BUS_LEFT], sizeof (sample_t) * BENCH_N_FRAMES);
+    }
+
+    synth_terminate (synth);
+    free (synth);
+
+    return bench_clock () - start;
+}
+
+static void bench_voices () {
+
+    size_t i;
+    size_t n_samples = BENCH_RATE * BENCH_SECONDS;
+    sample_t *output_scalar = calloc (n_samples, sizeof (sample_t));
+    sample_t *output_bank = calloc (n_samples, sizeof (sample_t));
+    double difference = 0;
+    double time_scalar = bench_voice_bank (false, output_scalar);
+    double time_bank = bench_voice_bank (true, output_bank);
+
+    for (i = 0; i < n_samples; i++)
+        if (fabs (output_scalar[i] - output_bank[i]) > difference)
+            difference = fabs (output_scalar[i] - output_bank[i]);
+
+    bench_report ("voices", "scalar", BENCH_N_FRAMES, time_scalar, n_samples);
+    bench_report ("voices", "bank", BENCH_N_FRAMES, time_bank, n_samples);
+    printf ("# voice bank speedup %.2f, max difference %g\n", time_scalar / time_bank, difference);
+
+    free (output_scalar);
+    free (output_bank);
+}
+
+/* synth_process_audio with n_voices strings spread over the playable range,
+ * the sympathetic wake up disabled so that only those run */
+static void bench_synth () {
+
+    size_t i;
+    size_t n_samples = BENCH_RATE * BENCH_SECONDS;
+    jack_default_audio_sample_t left[N_FRAMES_BLOCK];
+    jack_default_audio_sample_t right[N_FRAMES_BLOCK];
+    jack_default_audio_sample_t *outputs[N_OUTPUTS] = { NULL };
+
+    for (i = 0; i < BENCH_N_ELEMENTS (bench_n_voices); i++) {
+
+        size_t j;
+
+        for (j = 0; j < BENCH_N_ELEMENTS (bench_n_frames); j++) {
+
+            size_t k;
+            size_t n_voices = bench_n_voices[i];
+            size_t n_frames = bench_n_frames[j];
+            synth_t *synth = malloc (sizeof (synth_t));
+            char variant[32];
+            double start;
+
+            srand (1);
+            synth_init (synth);
+            synth_rate_set (synth, BENCH_RATE);
+            synth->threshold_sympathetic = HUGE_VAL;
+
+            for (k = 0; k < n_voices; k++)
+                synth_process_midi_note_on (synth, 0, VOICE_MIN + k * (VOICE_MAX - VOICE_MIN) / n_voices, 100);
+
+            start = bench_clock ();
+            for (k = 0; k < n_samples; k += n_frames) {
+
+                outputs[OUTPUT_LEFT] = left;
+                outputs[OUTPUT_RIGHT] = right;
+                synth_process_audio (synth, n_frames, outputs);
+                bench_sink += left[0] + right[0];
+            }
+
+            sprintf (variant, "voices=%lu", (unsigned long) n_voices);
+            bench_report ("synth", variant, n_frames, bench_clock () - start, n_samples);
+
+            synth_terminate (synth);
+            free (synth);
+        }
+    }
+}
+
+/* the whole synth with the body after the strings and folded into the plucks */
+static void bench_commuted () {
+
+    size_t i;
+    size_t n_samples = BENCH_RATE * BENCH_SECONDS;
+    jack_default_audio_sample_t left[N_FRAMES_BLOCK];
+    jack_default_audio_sample_t right[N_FRAMES_BLOCK];
+    jack_default_audio_sample_t *outputs[N_OUTPUTS] = { NULL };
+
+    for (i = 0; i < 2; i++) {
+
+        size_t k;
+        synth_t *synth = malloc (sizeof (synth_t));
+        double start;
+
+        srand (1);
+        synth_init (synth);
+        synth_commuted_set (synth, i);
+        synth_rate_set (synth, BENCH_RATE);
+        synth->threshold_sympathetic = HUGE_VAL;
+
+        for (k = 0; k < 8; k++)
+            synth_process_midi_note_on (synth, 0, VOICE_MIN + k * (VOICE_MAX - VOICE_MIN) / 8, 100);
+
+        start = bench_clock ();
+        for (k = 0; k < n_samples; k += BENCH_N_FRAMES_BUDGET) {
+
+            outputs[OUTPUT_LEFT] = left;
+            outputs[OUTPUT_RIGHT] = right;
+            synth_process_audio (synth, BENCH_N_FRAMES_BUDGET, outputs);
+            bench_sink += left[0] + right[0];
+        }
+
+        bench_report ("commuted", i ? "body=plucks" : "body=convolver",
+                      BENCH_N_FRAMES_BUDGET, bench_clock () - start, n_samples);
+
+        synth_terminate (synth);
+        free (synth);
+    }
+}
+
+/* the top octave as waveguides and as modes */
+static void bench_modal () {
+
+    size_t i;
+    size_t n_samples = BENCH_RATE * BENCH_SECONDS;
+    jack_default_audio_sample_t left[N_FRAMES_BLOCK];
+    jack_default_audio_sample_t right[N_FRAMES_BLOCK];
+    jack_default_audio_sample_t *outputs[N_OUTPUTS] = { NULL };
+
+    for (i = 0; i < 2; i++) {
+
+        size_t k;
+        synth_t *synth = malloc (sizeof (synth_t));
+        double start;
+
+        srand (1);
+        synth_init (synth);
+        synth_modal_set (synth, i ? VOICE_MAX - 12 : N_VOICES);
+        synth_rate_set (synth, BENCH_RATE);
+        synth->threshold_sympathetic = HUGE_VAL;
+
+        for (k = 0; k < 8; k++)
+            synth_process_midi_note_on (synth, 0, VOICE_MAX - 12 + k * 12 / 8, 100);
+
+        start = bench_clock ();
+        for (k = 0; k < n_samples; k += BENCH_N_FRAMES_BUDGET) {
+
+            outputs[OUTPUT_LEFT] = left;
+            outputs[OUTPUT_RIGHT] = right;
+            synth_process_audio (synth, BENCH_N_FRAMES_BUDGET, outputs);
+            bench_sink += left[0] + right[0];
+        }
+
+        bench_report ("modal", i ? "strings=modes" : "strings=waveguides",
+                      BENCH_N_FRAMES_BUDGET, bench_clock () - start, n_samples);
+
+        synth_terminate (synth);
+        free (synth);
+    }
+}
+
+/* the whole synth on patches with kernels of their own, each against one
+ * a hair off that runs the general ones */
+static void bench_patches () {
+
+    static const char *variants[] = {
+        "sympathetic=off", "sympathetic=faint",
+        "body=dry", "body=nearly dry", "body=wet", "body=nearly wet",
+        "bypass=none", "bypass=faint"
+    };
+    size_t i;
+    size_t n_samples = BENCH_RATE * BENCH_SECONDS;
+    jack_default_audio_sample_t left[N_FRAMES_BLOCK];
+    jack_default_audio_sample_t right[N_FRAMES_BLOCK];
+    jack_default_audio_sample_t *outputs[N_OUTPUTS] = { NULL };
+
+    for (i = 0; i < BENCH_N_ELEMENTS (variants); i++) {
+
+        size_t k;
+        patch_t patch;
+        synth_t *synth = malloc (sizeof (synth_t));
+        double start;
+
+        patch_init (&patch);
+        if (i < 2)
+            patch.sympathetic_resonance = i ? 1e-9 : 0;
+        else if (i < 6)
+            patch.resonance_body = (i < 4 ? 0 : 1) + (i % 2 ? (i < 4 ? 1e-9 : -1e-9) : 0);
+        else
+            patch.bridge_coefficient_bypass_min = patch.bridge_coefficient_bypass_max = i % 2 ? 1e-9 : 0;
+
+        srand (1);
+        synth_init_shared (synth, &patch, NULL);
+        synth_rate_set (synth, BENCH_RATE);
+        synth->threshold_sympathetic = HUGE_VAL;
+
+        for (k = 0; k < 8; k++)
+            synth_process_midi_note_on (synth, 0, VOICE_MIN + k * (VOICE_MAX - VOICE_MIN) / 8, 100);
+
+        start = bench_clock ();
+        for (k = 0; k < n_samples; k += BENCH_N_FRAMES_BUDGET) {
+
+            outputs[OUTPUT_LEFT] = left;
+            outputs[OUTPUT_RIGHT] = right;
+            synth_process_audio (synth, BENCH_N_FRAMES_BUDGET, outputs);
+            bench_sink += left[0] + right[0];
+        }
+
+        bench_report ("patch", variants[i], BENCH_N_FRAMES_BUDGET, bench_clock () - start, n_samples);
+
+        synth_terminate (synth);
+        free (synth);
+    }
+}
+
+/* held notes waking the strings that hear them, at the default threshold,
+ * with how many strings were active at most and at the end */
+static void bench_sympathetic () {
+
+    static const int chords[][4] = { { 60 }, { 48, 52, 55 }, { 36, 48, 55, 64 } };
+    static const size_t n_notes[] = { 1, 3, 4 };
+    size_t i;
+    size_t n_samples = BENCH_RATE * BENCH_SECONDS;
+    jack_default_audio_sample_t left[N_FRAMES_BLOCK];
+    jack_default_audio_sample_t right[N_FRAMES_BLOCK];
+    jack_default_audio_sample_t *outputs[N_OUTPUTS] = { NULL };
+
+    for (i = 0; i < BENCH_N_ELEMENTS (chords); i++) {
+
+        size_t k;
+        size_t n_voices_max = 0;
+        synth_t *synth = malloc (sizeof (synth_t));
+        char variant[32];
+        double start;
+
+        srand (1);
+        synth_init (synth);
+        synth_rate_set (synth, BENCH_RATE);
+
+        for (k = 0; k < n_notes[i]; k++)
+            synth_process_midi_note_on (synth, 0, chords[i][k], 100);
+
+        start = bench_clock ();
+        for (k = 0; k < n_samples; k += BENCH_N_FRAMES_BUDGET) {
+
+            outputs[OUTPUT_LEFT] = left;
+            outputs[OUTPUT_RIGHT] = right;
+            synth_process_audio (synth, BENCH_N_FRAMES_BUDGET, outputs);
+            bench_sink += left[0] + right[0];
+            if (synth->n_voices_active > n_voices_max)
+                n_voices_max = synth->n_voices_active;
+        }
+
+        sprintf (variant, "notes=%d", (int) n_notes[i]);
+        bench_report ("sympathetic", variant, BENCH_N_FRAMES_BUDGET, bench_clock () - start, n_samples);
+        printf ("# sympathetic, %s: %d strings active at most, %d at the end\n",
+                variant, (int) n_voices_max, (int) synth->n_voices_active);
+
+        synth_terminate (synth);
+        free (synth);
+    }
+}
+
+/* the whole synth with the strings waking each other, held at each tier
+ * the governor steps down through */
+static void bench_tiers () {
+
+    int tier;
+    size_t n_samples = BENCH_RATE * BENCH_SECONDS;
+    jack_default_audio_sample_t left[N_FRAMES_BLOCK];
+    jack_default_audio_sample_t right[N_FRAMES_BLOCK];
+    jack_default_audio_sample_t *outputs[N_OUTPUTS] = { NULL };
+
+    for (tier = TIER_FULL; tier < N_TIERS; tier++) {
+
+        size_t k;
+        synth_t *synth = malloc (sizeof (synth_t));
+        char variant[32];
+        double start;
+
+        srand (1);
+        synth_init (synth);
+        synth_rate_set (synth, BENCH_RATE);
+        synth_tier_set (synth, tier);
+
+        for (k = 0; k < 8; k++)
+            synth_process_midi_note_on (synth, 0, VOICE_MIN + k * (VOICE_MAX - VOICE_MIN) / 8, 100);
+
+        start = bench_clock ();
+        for (k = 0; k < n_samples; k += BENCH_N_FRAMES_BUDGET) {
+
+            outputs[OUTPUT_LEFT] = left;
+            outputs[OUTPUT_RIGHT] = right;
+            synth_process_audio (synth, BENCH_N_FRAMES_BUDGET, outputs);
+            bench_sink += left[0] + right[0];
+        }
+
+        sprintf (variant, "tier=%d", tier);
+        bench_report ("tiers", variant, BENCH_N_FRAMES_BUDGET, bench_clock () - start, n_samples);
+
+        synth_terminate (synth);
+        free (synth);
+    }
+}
+
+/* period of a signal near guess samples, by autocorrelation refined with a parabola */
+static double bench_period (const jack_default_audio_sample_t *signal, size_t n_samples, double guess) {
+
+    size_t lag;
+    size_t lag_min = guess * 0.8;
+    size_t lag_max = guess * 1.25 + 2;
+    size_t lag_best = lag_min + 1;
+    double *correlations = calloc (lag_max + 1, sizeof (double));
+    double a;
+    double b;
+    double c;
+
+    for (lag = lag_min; lag <= lag_max; lag++) {
+
+        size_t i;
+        for (i = 0; i + lag < n_samples; i++)
+            correlations[lag] += signal[i] * signal[i + lag];
+        if (lag > lag_min && lag < lag_max && correlations[lag] > correlations[lag_best])
+            lag_best = lag;
+    }
+
+    a = correlations[lag_best - 1];
+    b = correlations[lag_best];
+    c = correlations[lag_best + 1];
+    free (correlations);
+
+    return lag_best + (a - c) / (2 * (a - 2 * b + c));
+}
+
+/* seconds to decay by 60 dB, from a line fit to the level of short windows */
+static double bench_decay (const jack_default_audio_sample_t *signal, size_t n_samples) {
+
+    size_t i;
+    size_t n_window = BENCH_RATE * BENCH_STRINGS_WINDOW;
+    double n = 0;
+    double sum_t = 0;
+    double sum_l = 0;
+    double sum_tt = 0;
+    double sum_tl = 0;
+
+    for (i = 0; i + n_window <= n_samples; i += n_window) {
+
+        size_t j;
+        double energy = 0;
+        double t = (i + n_window / 2) / (double) BENCH_RATE;
+        double level;
+
+        for (j = 0; j < n_window; j++)
+            energy += signal[i + j] * signal[i + j];
+        level = 10 * log10 (energy / n_window + 1e-30);
+        if (level < VOICE_FLOOR)
+            break;
+
+        n++;
+        sum_t += t;
+        sum_l += level;
+        sum_tt += t * t;
+        sum_tl += t * level;
+    }
+
+    return -60 / ((n * sum_tl - sum_t * sum_l) / (n * sum_tt - sum_t * sum_t));
+}
+
+/* pitch and decay of single strings, compared to the ones
+ * in path_reference as written by a build of another precision */
+static void bench_strings (char *path_reference) {
+
+    int notes[] = { 36, 48, 60, 72, 84 };
+    size_t i;
+    size_t n_samples = BENCH_RATE * BENCH_STRINGS_SECONDS;
+    size_t n_skip = BENCH_RATE * BENCH_STRINGS_WINDOW;
+    jack_default_audio_sample_t *output = calloc (n_samples, sizeof (jack_default_audio_sample_t));
+    jack_default_audio_sample_t *outputs[N_OUTPUTS] = { NULL };
+    FILE *reference = NULL;
+    char line[256];
+
+    if (path_reference && !(reference = fopen (path_reference, "r"))) {
+
+        fprintf (stderr, "cldnt open da file %s... 😭\n", path_reference);
+        exit (EXIT_FAILURE);
+    }
+
+    printf ("precision,note,frequency,decay%s\n", reference ? ",error_cents,error_decay_percent" : "");
+    if (reference)
+        fgets (line, sizeof (line), reference);
+
+    for (i = 0; i < BENCH_N_ELEMENTS (notes); i++) {
+
+        synth_t *synth = malloc (sizeof (synth_t));
+        double frequency = 440 * pow (2, (notes[i] - 69) / 12.0);
+        double decay;
+
+        srand (1);
+        synth_init (synth);
+        synth_rate_set (synth, BENCH_RATE);
+        synth->threshold_sympathetic = HUGE_VAL;
+        synth_process_midi_note_on (synth, 0, notes[i], 100);
+        outputs[OUTPUT_LEFT] = output;
+        synth_process_audio (synth, n_samples, outputs);
+        synth_terminate (synth);
+        free (synth);
+
+        /* past the pluck itself */
+        frequency = BENCH_RATE / bench_period (output + n_skip, n_samples - n_skip, BENCH_RATE / frequency);
+        decay = bench_decay (output + n_skip, n_samples - n_skip);
+        printf ("%s,%d,%.4f,%.4f", bench_precision, notes[i], frequency, decay);
+
+        if (reference && fgets (line, sizeof (line), reference)) {
+
+            double frequency_reference = 0;
+            double decay_reference = 0;
+
+            sscanf (strchr (line, ',') + 1, "%*d,%lf,%lf", &frequency_reference, &decay_reference);
+            printf (",%.3f,%.3f",
+                    1200 * log (frequency / frequency_reference) / log (2),
+                    100 * (decay - decay_reference) / decay_reference);
+        }
+
+        putchar ('\n');
+    }
+
+    if (reference)
+        fclose (reference);
+    free (output);
+}
+
+/* csv on stdout, lines starting with # are comments;
+ * with strings as the first argument, see bench_strings */
+int main (int argc, char **argv) {
+
+    patch_init (&bench_patch);
+    coefficients_init (&bench_coefficients, &bench_patch, BENCH_RATE);
+
+    if (argc > 1 && !strcmp (argv[1], "strings")) {
+
+        bench_strings (argc > 2 ? argv[2] : NULL);
+        return EXIT_SUCCESS;
+    }
+
+    printf ("# rate %d, lanes %d, %s precision, %d s of audio per row, budget of %d frames\n",
+            BENCH_RATE, (int) N_LANES, bench_precision, BENCH_SECONDS, BENCH_N_FRAMES_BUDGET);
+    puts ("stage,variant,block,ns_per_sample,realtime_factor,budget_percent");
+
+    bench_filter ();
+    bench_delay ();
+    bench_convolver ();
+    bench_half_band ();
+    bench_voice ();
+    bench_excite ();
+    bench_voices ();
+    bench_synth ();
+    bench_commuted ();
+    bench_modal ();
+    bench_patches ();
+    bench_sympathetic ();
+    bench_tiers ();
+
+    return EXIT_SUCCESS;
+}
+
+#elif defined TARGET_RENDER
+
+#define RENDER_RATE 48000
+#define RENDER_N_FRAMES 256
+#define RENDER_TAIL_MAX 30 /* seconds rendered after the last event at most */
+
+typedef struct midi_event_t {
 
-        case 0xb0: /* control change */
-            printf ("control change: %x %x\n", data[1], data[2]);
-            synth_process_midi_cc (synth, channel, data[1], data[2]);
-            break;
+    unsigned long tick;
+    size_t order;
+    double time;
+    unsigned long tempo;        /* microseconds per quarter note, 0 unless a tempo change */
+    jack_midi_data_t data[3];
 
-        case 0xc0: /* program change */
-            break;
+} midi_event_t;
 
-        case 0xd0: /* channel pressure */
+/* the channel messages and tempo changes of a standard midi file, all tracks
+ * merged and sorted by time */
+typedef struct midi_file_t {
+
+    size_t n_events;
+    size_t n_events_allocated;
+    midi_event_t *events;
+
+} midi_file_t;
+
+static unsigned long midi_file_read_number (const unsigned char **pointer, const unsigned char *end) {
+
+    unsigned long value = 0;
+
+    while (*pointer < end) {
+
+        unsigned char byte = *(*pointer)++;
+        value = (value << 7) | (byte & 0x7f);
+        if (!(byte & 0x80))
             break;
+    }
 
-        case 0xe0: /* pitch bend */
-            printf ("pitch bend: %x %x\n", data[1], data[2]);
-            synth_process_midi_bend (synth, channel, data[1], data[2]);
+    return value;
+}
+
+static unsigned long midi_file_read_big_endian (const unsigned char *pointer, size_t n_bytes) {
+
+    unsigned long value = 0;
+
+    while (n_bytes--)
+        value = (value << 8) | *pointer++;
+
+    return value;
+}
+
+static midi_event_t *midi_file_event_add (midi_file_t *midi, unsigned long tick) {
+
+    midi_event_t *event;
+
+    if (midi->n_events == midi->n_events_allocated) {
+
+        midi->n_events_allocated = midi->n_events_allocated ? 2 * midi->n_events_allocated : 256;
+        midi->events = realloc (midi->events, midi->n_events_allocated * sizeof (midi_event_t));
+    }
+
+    event = &midi->events[midi->n_events];
+    memset (event, 0, sizeof (midi_event_t));
+    event->tick = tick;
+    event->order = midi->n_events++;
+
+    return event;
+}
+
+static void midi_file_read_track (midi_file_t *midi, const unsigned char *pointer, const unsigned char *end) {
+
+    unsigned long tick = 0;
+    unsigned char status = 0;
+
+    while (pointer < end) {
+
+        unsigned char byte;
+
+        tick += midi_file_read_number (&pointer, end);
+        if (pointer >= end)
             break;
+
+        byte = *pointer;
+
+        if (byte == 0xff) { /* meta event */
+
+            unsigned char type;
+            unsigned long length;
+
+            if (end - pointer < 2)
+                break;
+            type = pointer[1];
+            pointer += 2;
+            length = midi_file_read_number (&pointer, end);
+            if (length > (unsigned long) (end - pointer))
+                break;
+            if (type == 0x51 && length == 3)
+                midi_file_event_add (midi, tick)->tempo = midi_file_read_big_endian (pointer, 3);
+            if (type == 0x2f)
+                break;
+            pointer += length;
+
+        } else if (byte == 0xf0 || byte == 0xf7) { /* sysex */
+
+            unsigned long length;
+
+            pointer++;
+            length = midi_file_read_number (&pointer, end);
+            if (length > (unsigned long) (end - pointer))
+                break;
+            pointer += length;
+            status = 0;
+
+        } else { /* channel message, possibly with running status */
+
+            size_t n_data;
+            midi_event_t *event;
+
+            if (byte & 0x80)
+                status = *pointer++;
+            if (!status)
+                break;
+
+            n_data = (status & 0xf0) == 0xc0 || (status & 0xf0) == 0xd0 ? 1 : 2;
+            if ((size_t) (end - pointer) < n_data)
+                break;
+
+            event = midi_file_event_add (midi, tick);
+            event->data[0] = status;
+            memcpy (event->data + 1, pointer, n_data);
+            pointer += n_data;
+        }
     }
 }
 
-typedef struct jack_context_t {
+static int midi_file_event_compare (const void *a, const void *b) {
 
-    jack_client_t *client;
-    jack_port_t *port_midi_in;
-    jack_port_t *port_audio_out;
-    
-    synth_t synth;
+    const midi_event_t *event_a = a;
+    const midi_event_t *event_b = b;
 
-} jack_context_t;
+    if (event_a->tick != event_b->tick)
+        return event_a->tick < event_b->tick ? -1 : 1;
+    return event_a->order < event_b->order ? -1 : event_a->order > event_b->order;
+}
 
-int jack_process (jack_nframes_t n_frames, void *arg) {
+bool midi_file_load (midi_file_t *midi, char *path) {
 
+    FILE *stream;
+    long n_bytes;
+    unsigned char *data;
+    const unsigned char *pointer;
+    const unsigned char *end;
+    unsigned long n_tracks;
+    long division;
+    double seconds_per_tick;
+    unsigned long tick = 0;
+    double time = 0;
     size_t i;
 
-    jack_context_t *context = (jack_context_t *) arg;
+    memset (midi, 0, sizeof (midi_file_t));
 
-    jack_default_audio_sample_t *buffer_audio_out =
-        (jack_default_audio_sample_t *) jack_port_get_buffer (context->port_audio_out, n_frames);
-    void *buffer_midi_in =              jack_port_get_buffer (context->port_midi_in, n_frames);
+    if (!(stream = fopen (path, "rb")))
+        return false;
 
-    jack_nframes_t n_events = jack_midi_get_event_count (buffer_midi_in);
+    fseek (stream, 0, SEEK_END);
+    n_bytes = ftell (stream);
+    rewind (stream);
+    data = malloc (n_bytes);
+    n_bytes = fread (data, 1, n_bytes, stream);
+    fclose (stream);
+
+    if (n_bytes < 14 || memcmp (data, "MThd", 4)) {
+
+        free (data);
+        return false;
+    }
+
+    n_tracks = midi_file_read_big_endian (data + 10, 2);
+    division = midi_file_read_big_endian (data + 12, 2);
+
+    /* smpte division: frames per second in the high byte, ticks per frame in the low */
+    if (division & 0x8000)
+        seconds_per_tick = 1.0 / ((256 - (division >> 8)) * (division & 0xff));
+    else
+        seconds_per_tick = 500000e-6 / division;
+
+    pointer = data + 8 + midi_file_read_big_endian (data + 4, 4);
+    end = data + n_bytes;
+
+    while (n_tracks && end - pointer >= 8) {
+
+        unsigned long length = midi_file_read_big_endian (pointer + 4, 4);
+        bool track = !memcmp (pointer, "MTrk", 4);
+
+        pointer += 8;
+        if (length > (unsigned long) (end - pointer))
+            length = end - pointer;
+        if (track) {
+
+            midi_file_read_track (midi, pointer, pointer + length);
+            n_tracks--;
+        }
+        pointer += length;
+    }
+
+    free (data);
+
+    /* tempo changes apply to every track so the times are worked out after merging */
+    qsort (midi->events, midi->n_events, sizeof (midi_event_t), midi_file_event_compare);
+
+    for (i = 0; i < midi->n_events; i++) {
+
+        midi_event_t *event = &midi->events[i];
+
+        time += (event->tick - tick) * seconds_per_tick;
+        tick = event->tick;
+        event->time = time;
+
+        if (event->tempo && !(division & 0x8000))
+            seconds_per_tick = event->tempo * 1e-6 / division;
+    }
+
+    return true;
+}
+
+void midi_file_terminate (midi_file_t *midi) {
+
+    free (midi->events);
+}
+
+static void render_write_number (FILE *stream, unsigned long value, size_t n_bytes) {
+
+    while (n_bytes--) {
+
+        fputc (value & 0xff, stream);
+        value >>= 8;
+    }
+}
+
+/* 32 bit float stereo wav header */
+static void render_write_header (FILE *stream, unsigned long rate, unsigned long n_frames) {
+
+    unsigned long n_bytes = n_frames * 2 * sizeof (jack_default_audio_sample_t);
+
+    fwrite ("RIFF", 1, 4, stream);
+    render_write_number (stream, 36 + n_bytes, 4);
+    fwrite ("WAVEfmt ", 1, 8, stream);
+    render_write_number (stream, 16, 4);
+    render_write_number (stream, 3, 2);
+    render_write_number (stream, 2, 2);
+    render_write_number (stream, rate, 4);
+    render_write_number (stream, rate * 2 * sizeof (jack_default_audio_sample_t), 4);
+    render_write_number (stream, 2 * sizeof (jack_default_audio_sample_t), 2);
+    render_write_number (stream, 8 * sizeof (jack_default_audio_sample_t), 2);
+    fwrite ("data", 1, 4, stream);
+    render_write_number (stream, n_bytes, 4);
+}
+
+static double render_clock () {
+
+    struct timespec time;
+    clock_gettime (CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+int main (int argc, char **argv) {
+
+    static synth_t synth;
+    jack_default_audio_sample_t left[RENDER_N_FRAMES];
+    jack_default_audio_sample_t right[RENDER_N_FRAMES];
+    jack_default_audio_sample_t frames[2 * RENDER_N_FRAMES];
+    jack_default_audio_sample_t *outputs[N_OUTPUTS];
+    midi_file_t midi;
+    FILE *stream;
+    char *extension;
+    bool wav;
+    unsigned long rate = RENDER_RATE;
+    unsigned long n_frames = 0;
+    unsigned long n_frames_tail = 0;
+    size_t i_event = 0;
+    double start;
+    double seconds;
+
+    if (argc < 3) {
+
+        fprintf (stderr, "usage: %s input.mid output.wav|output.raw [rate]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (argc > 3)
+        rate = strtoul (argv[3], NULL, 10);
+
+    if (!midi_file_load (&midi, argv[1])) {
+
+        fprintf (stderr, "cldnt read da midi file %s... 😭\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    if (!(stream = fopen (argv[2], "wb"))) {
+
+        fprintf (stderr, "cldnt open da file %s... 😭\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    extension = strrchr (argv[2], '.');
+    wav = extension && !strcmp (extension, ".wav");
+    if (wav)
+        render_write_header (stream, rate, 0);
+
+    srand (1);
+    synth_init (&synth);
+    synth_rate_set (&synth, rate);
+
+    start = render_clock ();
+
+    /* run until the last event, then until every string has gone quiet */
+    while (i_event < midi.n_events
+            || (synth.n_voices_active && n_frames_tail < RENDER_TAIL_MAX * rate)) {
+
+        jack_nframes_t i;
+        jack_nframes_t i_frame = 0;
+        jack_nframes_t n = RENDER_N_FRAMES;
+
+        memset (outputs, 0, sizeof (outputs));
+        outputs[OUTPUT_LEFT] = left;
+        outputs[OUTPUT_RIGHT] = right;
+        synth_period_begin (&synth);
+
+        for (; i_event < midi.n_events; i_event++) {
+
+            midi_event_t *event = &midi.events[i_event];
+            unsigned long frame = (unsigned long) (event->time * rate + 0.5);
+
+            if (frame >= n_frames + RENDER_N_FRAMES)
+                break;
+
+            if (frame > n_frames + i_frame) {
+
+                synth_process (&synth, frame - n_frames - i_frame, outputs);
+                i_frame = frame - n_frames;
+            }
+
+            if (!event->tempo)
+                synth_process_midi (&synth, event->data);
+        }
+
+        if (i_event == midi.n_events && !synth.n_voices_active)
+            n = i_frame;
+
+        synth_process (&synth, n - i_frame, outputs);
+        synth_period_end (&synth, n);
+        for (i = 0; i < n; i++) {
+
+            frames[2 * i] = left[i];
+            frames[2 * i + 1] = right[i];
+        }
+        fwrite (frames, sizeof (jack_default_audio_sample_t), 2 * n, stream);
+        synth_log_drain (&synth, stdout);
+        synth_telemetry_drain (&synth, stdout);
+        synth_loader_poll (&synth);
+
+        n_frames += n;
+        if (i_event == midi.n_events)
+            n_frames_tail += n;
+    }
+
+    seconds = render_clock () - start;
+    synth_report (&synth, stdout);
 
-    size_t i_frame = 0;
+    if (wav) {
 
-    for (i = 0; i < n_events; i++) {
+        rewind (stream);
+        render_write_header (stream, rate, n_frames);
+    }
+
+    fclose (stream);
+    synth_terminate (&synth);
+    midi_file_terminate (&midi);
+
+    fprintf (stderr, "rendered %.2f s in %.2f s, realtime factor %.1f\n",
+             n_frames / (double) rate, seconds, n_frames / (double) rate / seconds);
+
+    return EXIT_SUCCESS;
+}
+
+#elif defined TARGET_BANK
+
+static const double bank_rates[] = { BANK_RATES };
+
+/* appends a block at the next aligned offset, which it returns */
+static uint64_t bank_write (FILE *stream, const void *data, size_t n_bytes) {
+
+    long offset = ftell (stream);
+
+    while (offset % BANK_ALIGNMENT) {
+
+        fputc (0, stream);
+        offset++;
+    }
+
+    fwrite (data, 1, n_bytes, stream);
+    return offset;
+}
+
+int main (int argc, char **argv) {
+
+    size_t i;
+    size_t n_entries = argc > 2 ? (size_t) argc - 2 : sizeof (paths_impulse_response) / sizeof (paths_impulse_response[0]);
+    size_t n_rates = sizeof (bank_rates) / sizeof (bank_rates[0]);
+    bank_header_t header;
+    bank_entry_t *entries;
+    FILE *stream;
+
+    if (argc < 2 || n_rates > BANK_N_RATES_MAX) {
+
+        fprintf (stderr, "usage: %s output.bank [body.pcm|body.wav ...], the programs by default\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (!(stream = fopen (argv[1], "wb"))) {
+
+        fprintf (stderr, "cldnt open da file %s... 😭\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    memset (&header, 0, sizeof (bank_header_t));
+    memcpy (header.magic, BANK_MAGIC, sizeof (header.magic));
+    header.version = BANK_VERSION;
+    header.n_entries = n_entries;
+    header.size_sample = sizeof (sample_t);
+    header.size_partition = CONVOLVER_PARTITION_SIZE;
+    header.n_rates = n_rates;
+    for (i = 0; i < n_rates; i++)
+        header.rates[i] = bank_rates[i];
+
+    /* the blocks go after the table, which is filled in last */
+    entries = calloc (n_entries, sizeof (bank_entry_t));
+    fseek (stream, bank_align (sizeof (bank_header_t)) + n_entries * sizeof (bank_entry_t), SEEK_SET);
+
+    for (i = 0; i < n_entries; i++) {
+
+        size_t j;
+        const char *path = argc > 2 ? argv[i + 2] : paths_impulse_response[i];
+        const char *name = strrchr (path, '/') ? strrchr (path, '/') + 1 : path;
+        bank_entry_t *entry = &entries[i];
+        buffer_t impulse_response;
+
+        if (!buffer_load (&impulse_response, &entry->rate, path))
+            return EXIT_FAILURE;
+
+        strncpy (entry->name, name, BANK_SIZE_NAME - 1);
+        entry->n_channels = 1;
+        entry->n_samples = impulse_response.n_samples;
+        entry->offset = bank_write (stream, impulse_response.data, impulse_response.n_samples * sizeof (sample_t));
+
+        for (j = 0; j < n_rates; j++) {
+
+            buffer_t resampled;
+            kernel_t *kernel;
+            size_t n_values;
+
+            buffer_resample (&resampled, &impulse_response, bank_rates[j] / entry->rate);
+            kernel = kernel_create (&resampled);
+            n_values = kernel->n_partitions * (CONVOLVER_PARTITION_SIZE + 1);
+
+            entry->kernels[j].n_partitions = kernel->n_partitions;
+            entry->kernels[j].offset = bank_write (stream, kernel->head, CONVOLVER_PARTITION_SIZE * sizeof (sample_t));
+            fwrite (kernel->partitions_real, sizeof (sample_t), n_values, stream);
+            fwrite (kernel->partitions_imaginary, sizeof (sample_t), n_values, stream);
+
+            kernel_destroy (kernel);
+            buffer_terminate (&resampled);
+        }
+
+        printf ("%s: %lu samples at %g Hz\n", entry->name, (unsigned long) entry->n_samples, entry->rate);
+        buffer_terminate (&impulse_response);
+    }
+
+    rewind (stream);
+    fwrite (&header, sizeof (bank_header_t), 1, stream);
+    fseek (stream, bank_align (sizeof (bank_header_t)), SEEK_SET);
+    fwrite (entries, sizeof (bank_entry_t), n_entries, stream);
+
+    free (entries);
+    if (fclose (stream)) {
+
+        fprintf (stderr, "cldnt write da bank %s... 😭\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+#elif defined TARGET_LV2
+
+#define PLUGIN_URI "urn:synth" /* as in synth.lv2/synth.ttl */
+#define URI_MIDI_EVENT "http://lv2plug.in/ns/ext/midi#MidiEvent" /* LV2_MIDI__MidiEvent, its header is no c89 */
+#define PORT_MIDI_IN 0
+#define PORT_AUDIO_OUT 1 /* the first of N_OUTPUTS */
+
+/* of every instance in the host, made with the first and gone with the last */
+static library_t lv2_library;
+static size_t lv2_n_instances;
+static pthread_mutex_t lv2_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct lv2_context_t {
+
+    synth_t *synth;
+    const LV2_Atom_Sequence *port_midi_in;
+    jack_default_audio_sample_t *ports_audio_out[N_OUTPUTS];
+    LV2_URID urid_midi_event;
+    LV2_Worker_Schedule *schedule;
+    bool scheduled;                 /* a poll of the loader is under way, see lv2_work */
+
+} lv2_context_t;
+
+/* without a pool or a thread of its own, the strings run on the host's
+ * process thread and the loader on its worker */
+static LV2_Handle lv2_instantiate (const LV2_Descriptor *descriptor, double rate,
+                                   const char *bundle_path, const LV2_Feature *const *features) {
+
+    size_t i;
+    LV2_URID_Map *map = NULL;
+    LV2_Worker_Schedule *schedule = NULL;
+    lv2_context_t *context;
+
+    for (i = 0; features[i]; i++) {
+
+        if (!strcmp (features[i]->URI, LV2_URID__map))
+            map = features[i]->data;
+        else if (!strcmp (features[i]->URI, LV2_WORKER__schedule))
+            schedule = features[i]->data;
+    }
+
+    if (!map || !schedule) {
+
+        fputs ("dis host cant map uwids or scheduwe work... 😭\n", stderr);
+        return NULL;
+    }
+
+    /* the bodies and the bank come with the bundle */
+    pthread_mutex_lock (&lv2_mutex);
+    if (!lv2_n_instances++)
+        library_init (&lv2_library, bundle_path);
+    pthread_mutex_unlock (&lv2_mutex);
+
+    context = calloc (1, sizeof (lv2_context_t));
+    context->urid_midi_event = map->map (map->handle, URI_MIDI_EVENT);
+    context->schedule = schedule;
+
+    context->synth = malloc (sizeof (synth_t));
+    synth_init_shared (context->synth, &lv2_library.patch, &lv2_library);
+    synth_rate_set (context->synth, rate);
+
+    return context;
+}
+
+static void lv2_connect_port (LV2_Handle instance, uint32_t port, void *data) {
+
+    lv2_context_t *context = instance;
+
+    if (port == PORT_MIDI_IN)
+        context->port_midi_in = data;
+    else if (port - PORT_AUDIO_OUT < N_OUTPUTS)
+        context->ports_audio_out[port - PORT_AUDIO_OUT] = data;
+}
+
+/* straight into the host's buffers, split at the frame of every midi event */
+static void lv2_run (LV2_Handle instance, uint32_t n_frames) {
+
+    lv2_context_t *context = instance;
+    synth_t *synth = context->synth;
+    jack_default_audio_sample_t *outputs[N_OUTPUTS];
+    const LV2_Atom_Sequence *sequence = context->port_midi_in;
+    const LV2_Atom_Event *event = (const LV2_Atom_Event *) (sequence + 1);
+    const char *end = (const char *) &sequence->body + sequence->atom.size;
+    uint32_t i_frame = 0;
+
+    memcpy (outputs, context->ports_audio_out, sizeof (outputs));
+    synth_period_begin (synth);
 
-        jack_midi_event_t event;
-        jack_midi_event_get (&event, buffer_midi_in, i);
+    /* lv2_atom_sequence_begin and so on, the events padded to 8 bytes */
+    for (; (const char *) event < end;
+         event = (const LV2_Atom_Event *) ((const char *) (event + 1) + ((event->body.size + 7) & ~7u))) {
+
+        jack_midi_data_t data[3] = { 0 };
+        int64_t frame = event->time.frames;
+
+        if (event->body.type != context->urid_midi_event || !event->body.size)
+            continue;
+
+        if (frame < i_frame)
+            frame = i_frame;
+        if (frame > n_frames)
+            frame = n_frames;
 
         /* process audio frames up to the time of this event */
-        synth_process_audio (&context->synth,
-                             event.time - i_frame,
-                             buffer_audio_out + i_frame);
-        i_frame = event.time;
-        
+        synth_process (synth, frame - i_frame, outputs);
+        i_frame = frame;
+
         /* process the midi event */
-        synth_process_midi (&context->synth, event.buffer);
+        memcpy (data, event + 1, event->body.size < sizeof (data) ? event->body.size : sizeof (data));
+        synth_process_midi (synth, data);
     }
 
     /* process remaining audio frames */
-    synth_process_audio (&context->synth,
-                         n_frames - i_frame,
-                         buffer_audio_out + i_frame);
+    synth_process (synth, n_frames - i_frame, outputs);
 
-    /* process audio */
-    return 0;
+    synth_period_end (synth, n_frames);
+
+    if (!context->scheduled && synth_loader_due (synth))
+        context->scheduled = context->schedule->schedule_work (context->schedule->handle, 0, NULL)
+                             == LV2_WORKER_SUCCESS;
 }
 
-int jack_set_rate (jack_nframes_t rate, void *arg) {
+/* loads program changes and frees what the process thread let go of,
+ * on the host's worker thread */
+static LV2_Worker_Status lv2_work (LV2_Handle instance, LV2_Worker_Respond_Function respond,
+                                   LV2_Worker_Respond_Handle handle, uint32_t size, const void *data) {
 
-    jack_context_t *context = (jack_context_t *) arg;
+    lv2_context_t *context = instance;
+
+    synth_loader_poll (context->synth);
+    return respond (handle, 0, NULL);
+}
 
-    context->synth.rate = rate;
-    context->synth.delta_time = 1.0 / rate;
-    synth_update (&context->synth);
+/* back on the process thread */
+static LV2_Worker_Status lv2_work_response (LV2_Handle instance, uint32_t size, const void *body) {
 
-    return 0;
+    lv2_context_t *context = instance;
+
+    context->scheduled = false;
+    return LV2_WORKER_SUCCESS;
 }
 
-void jack_shutdown (void *arg) {
+static const LV2_Worker_Interface lv2_worker = { lv2_work, lv2_work_response, NULL };
 
-    fputs ("what...... jack shutdown apparently..... bye bye.... x_x", stderr);
-    exit (EXIT_FAILURE);
+static const void *lv2_extension_data (const char *uri) {
+
+    return strcmp (uri, LV2_WORKER__interface) ? NULL : &lv2_worker;
+}
+
+static void lv2_cleanup (LV2_Handle instance) {
+
+    lv2_context_t *context = instance;
+
+    synth_terminate (context->synth);
+    free (context->synth);
+    free (context);
+
+    pthread_mutex_lock (&lv2_mutex);
+    if (!--lv2_n_instances)
+        library_terminate (&lv2_library);
+    pthread_mutex_unlock (&lv2_mutex);
+}
+
+static const LV2_Descriptor lv2_plugin = {
+
+    PLUGIN_URI,
+    lv2_instantiate,
+    lv2_connect_port,
+    NULL,
+    lv2_run,
+    NULL,
+    lv2_cleanup,
+    lv2_extension_data
+};
+
+LV2_SYMBOL_EXPORT const LV2_Descriptor *lv2_descriptor (uint32_t index) {
+
+    return index ? NULL : &lv2_plugin;
 }
 
+#else
+
+/* the stems are numbered after these */
+static const char *names_output[OUTPUT_STEM] = { "out_left", "out_right", "dry_left", "dry_right" };
+
 int main (int argc, char **argv) {
 
+    size_t i;
+
     srand (time (NULL));
 
     jack_context_t *context = malloc (sizeof (jack_context_t));
@@ -679,14 +7126,64 @@ int main (int argc, char **argv) {
         return EXIT_FAILURE;
     }
 
-    synth_init (&context->synth);
+    ensemble_init (&context->ensemble);
+
+    /* then a synth for each channel[:program[:lowest:highest[:commuted[:patch]]]],
+     * channel 0 for all the others, playing the strings of its patch unless told */
+    for (i = 2; i < (size_t) argc; i++) {
+
+        int channel = 0;
+        int program = 0;
+        int lowest = 0;
+        int highest = 0;
+        int commuted = COMMUTED;
+        char path[SIZE_PATH] = "";
+        patch_t patch = context->ensemble.library.patch;
+        synth_t *synth = NULL;
+        int n_fields = sscanf (argv[i], "%d:%d:%d:%d:%d:%4095s", &channel, &program, &lowest, &highest, &commuted, path);
+
+        if (*path && !patch_load (&patch, path)) {
+
+            fprintf (stderr, "cldnt open da patch %s... 😭\n", path);
+            return EXIT_FAILURE;
+        }
+        if (n_fields < 4) {
+
+            lowest = patch.voice_min;
+            highest = patch.voice_max - 1;
+        }
+
+        if (n_fields < 1
+            || !(synth = ensemble_add (&context->ensemble, &patch, channel, program, lowest, highest + 1))) {
+
+            fprintf (stderr, "dunno wat to do with %s... 😭 wanted channel[:program[:lowest:highest[:commuted[:patch]]]]\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+        synth_commuted_set (synth, commuted);
+    }
+
+    if (!context->ensemble.n_synths)
+        ensemble_add (&context->ensemble, &context->ensemble.library.patch, 0, 0,
+                      context->ensemble.library.patch.voice_min, context->ensemble.library.patch.voice_max);
+
+    ensemble_service_start (&context->ensemble);
+    pool_start (&context->ensemble.pool, argc > 1 ? strtoul (argv[1], NULL, 10) : N_WORKERS);
 
     jack_set_process_callback     (context->client, jack_process,  context);
     jack_set_sample_rate_callback (context->client, jack_set_rate, context);
+    jack_set_xrun_callback        (context->client, jack_xrun,     context);
     jack_on_shutdown              (context->client, jack_shutdown, context);
 
     context->port_midi_in = jack_port_register (context->client, "midi_in", JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0);
-    context->port_audio_out = jack_port_register (context->client, "audio_out", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+    for (i = 0; i < N_OUTPUTS; i++) {
+
+        char name[32];
+        if (i >= OUTPUT_STEM)
+            sprintf (name, "stem_%d", (int) (i - OUTPUT_STEM + 1));
+        else
+            strcpy (name, names_output[i]);
+        context->ports_audio_out[i] = jack_port_register (context->client, name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+    }
 
     if (jack_activate (context->client)) {
 
@@ -694,14 +7191,18 @@ int main (int argc, char **argv) {
         return EXIT_FAILURE;
     }
 
-    jack_connect (context->client, "synth:audio_out", "system:playback_1");
-    jack_connect (context->client, "synth:audio_out", "system:playback_2");
+    jack_connect (context->client, "synth:out_left", "system:playback_1");
+    jack_connect (context->client, "synth:out_right", "system:playback_2");
 
     pause ();
 
-    synth_terminate (&context->synth);
+    pool_stop (&context->ensemble.pool);
+    ensemble_service_stop (&context->ensemble);
+    ensemble_terminate (&context->ensemble);
 
     jack_client_close (context->client);
 
     return EXIT_SUCCESS;
 }
+
+#endif